@@ -0,0 +1,271 @@
+/**
+ * benchmarks for the renderer's pieces (micro) and for whole frames (macro)
+ *
+ * every benchmark is run a few times untimed to warm up and to find how many iterations take
+ * at least --min-time, then timed for --repeats samples of that many iterations each. results
+ * are summarized per iteration (min, median, mean, standard deviation, max), and can be saved
+ * as json and compared against an earlier run, which fails if anything got slower
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench.h"
+
+// how one benchmark did, in seconds per iteration
+struct BenchResult {
+	std::string name;
+	long long iterations; // per sample
+	int samples;
+	double min, median, mean, stddev, max;
+	long long items;
+	std::string unit;
+};
+
+// a baseline's numbers for one benchmark
+struct BaselineEntry {
+	double min;
+	double median;
+};
+
+static double elapsed_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// seconds for iterations runs of body
+static double time_runs(const std::function<void()> &body, long long iterations) {
+	auto start = std::chrono::steady_clock::now();
+	for (long long i = 0; i < iterations; ++i) body();
+	return elapsed_since(start);
+}
+
+static BenchResult run_benchmark(const Benchmark &b, int repeats, double min_time) {
+	auto c = b.factory();
+
+	// warm up, then keep doubling the iterations until a sample is long enough to time well
+	time_runs(c.body, 1);
+	long long iterations = 1;
+	while (iterations < (1LL << 30) && time_runs(c.body, iterations) < min_time) iterations *= 2;
+
+	std::vector<double> samples(repeats);
+	for (auto &s : samples) s = time_runs(c.body, iterations) / iterations;
+	std::sort(samples.begin(), samples.end());
+
+	BenchResult r;
+	r.name = b.name;
+	r.iterations = iterations;
+	r.samples = repeats;
+	r.min = samples.front();
+	r.max = samples.back();
+	r.median = repeats % 2 ? samples[repeats / 2] : (samples[repeats / 2 - 1] + samples[repeats / 2]) / 2;
+	double sum = 0;
+	for (auto s : samples) sum += s;
+	r.mean = sum / repeats;
+	double squares = 0;
+	for (auto s : samples) squares += (s - r.mean) * (s - r.mean);
+	r.stddev = repeats > 1 ? std::sqrt(squares / (repeats - 1)) : 0;
+	r.items = c.items;
+	r.unit = c.unit ? c.unit : "";
+	return r;
+}
+
+// seconds as something readable
+static std::string format_time(double seconds) {
+	char buffer[32];
+	if (seconds < 1e-6) {
+		snprintf(buffer, sizeof(buffer), "%.1f ns", seconds * 1e9);
+	} else if (seconds < 1e-3) {
+		snprintf(buffer, sizeof(buffer), "%.2f us", seconds * 1e6);
+	} else if (seconds < 1) {
+		snprintf(buffer, sizeof(buffer), "%.2f ms", seconds * 1e3);
+	} else {
+		snprintf(buffer, sizeof(buffer), "%.3f s", seconds);
+	}
+	return buffer;
+}
+
+static void print_result(const BenchResult &r) {
+	auto spread = r.mean > 0 ? 100 * r.stddev / r.mean : 0;
+	printf("%-40s %11s %11s %11s %6.1f%%", r.name.c_str(), format_time(r.median).c_str(), format_time(r.min).c_str(),
+		format_time(r.mean).c_str(), spread);
+	if (r.items && r.median > 0) printf("  %10.2f M%s/s", r.items / r.median / 1e6, r.unit.c_str());
+	printf("\n");
+	fflush(stdout);
+}
+
+// one benchmark per line, so a baseline can be read back without a json parser
+static bool write_json(const char *path, const std::vector<BenchResult> &results) {
+	std::ofstream out(path);
+	out << "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		auto &r = results[i];
+		char line[512];
+		snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"iterations\": %lld, \"samples\": %d, \"min_ns\": %.3f, \"median_ns\": %.3f, "
+			"\"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"max_ns\": %.3f, \"items\": %lld, \"unit\": \"%s\"}%s\n",
+			r.name.c_str(), r.iterations, r.samples, r.min * 1e9, r.median * 1e9, r.mean * 1e9, r.stddev * 1e9, r.max * 1e9,
+			r.items, r.unit.c_str(), i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n}\n";
+	if (!out) {
+		std::cerr << "can't write " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+// the number after "key": on line, if it's there
+static bool read_number(const std::string &line, const char *key, double &value) {
+	auto at = line.find(std::string("\"") + key + "\":");
+	if (at == std::string::npos) return false;
+	value = std::atof(line.c_str() + at + strlen(key) + 3);
+	return true;
+}
+
+// read back what write_json wrote
+static bool read_baseline(const char *path, std::map<std::string, BaselineEntry> &baseline) {
+	std::ifstream in(path);
+	if (!in) {
+		std::cerr << "can't read the baseline " << path << "\n";
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		auto at = line.find("\"name\": \"");
+		if (at == std::string::npos) continue;
+		auto start = at + 9;
+		auto end = line.find('"', start);
+		BaselineEntry entry;
+		if (end == std::string::npos || !read_number(line, "min_ns", entry.min) || !read_number(line, "median_ns", entry.median)) continue;
+		entry.min *= 1e-9;
+		entry.median *= 1e-9;
+		baseline[line.substr(start, end - start)] = entry;
+	}
+	return true;
+}
+
+// compare results to a baseline. a benchmark has regressed if both its median and its best run
+// are more than threshold (a fraction) slower, which a noisy sample or two can't cause alone.
+// returns how many regressed
+static int compare(const std::vector<BenchResult> &results, const std::map<std::string, BaselineEntry> &baseline, double threshold) {
+	printf("\n%-40s %11s %11s %8s\n", "compared to baseline", "before", "after", "change");
+	auto regressions = 0;
+	for (auto &r : results) {
+		auto found = baseline.find(r.name);
+		if (found == baseline.end()) {
+			printf("%-40s %11s %11s %8s  new\n", r.name.c_str(), "-", format_time(r.median).c_str(), "");
+			continue;
+		}
+		auto &b = found->second;
+		auto change = b.median > 0 ? r.median / b.median - 1 : 0;
+		auto best_change = b.min > 0 ? r.min / b.min - 1 : 0;
+		const char *verdict = "";
+		if (change > threshold && best_change > threshold) {
+			verdict = "  REGRESSED";
+			regressions++;
+		} else if (change < -threshold && best_change < -threshold) {
+			verdict = "  improved";
+		}
+		printf("%-40s %11s %11s %+7.1f%%%s\n", r.name.c_str(), format_time(b.median).c_str(), format_time(r.median).c_str(),
+			change * 100, verdict);
+	}
+	return regressions;
+}
+
+// does name match any of the comma separated parts of filter
+static bool matches(const std::string &name, const std::string &filter) {
+	if (filter.empty()) return true;
+	std::stringstream parts(filter);
+	std::string part;
+	while (std::getline(parts, part, ',')) {
+		if (!part.empty() && name.find(part) != std::string::npos) return true;
+	}
+	return false;
+}
+
+// usage: renderer_bench [--filter TEXT[,TEXT...]] [--list] [--repeats N] [--min-time MS] [--threads N]
+//                       [--large] [--data DIR] [--tmp DIR] [--json FILE] [--baseline FILE] [--threshold PERCENT]
+//   --filter T    only run benchmarks whose name contains one of the comma separated T
+//   --list        print the benchmarks' names and exit
+//   --repeats N   timed samples per benchmark, 10 by default
+//   --min-time MS each sample runs enough iterations to take at least MS milliseconds, 50 by default
+//   --threads N   threads the whole-frame benchmarks render on, 1 by default
+//   --large       also run the 10 million triangle mesh
+//   --data DIR    where the bundled model lives, ../data by default (as for the renderer)
+//   --tmp DIR     where scratch files go, /tmp by default
+//   --json F      save the results to F
+//   --baseline F  compare against results saved earlier with --json, exiting with 1 if anything
+//                 got slower by more than the threshold
+//   --threshold P percentage slower that counts as a regression, 5 by default
+int main(int argc, char *argv[]) {
+	BenchConfig config{"../data", "/tmp", 1, false};
+	std::string filter;
+	auto list = false;
+	auto repeats = 10;
+	auto min_time = 0.05;
+	auto threshold = 0.05;
+	const char *json_path = nullptr;
+	const char *baseline_path = nullptr;
+	for (auto i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (!strcmp(argv[i], "--list")) {
+			list = true;
+		} else if (!strcmp(argv[i], "--repeats") && i + 1 < argc && (repeats = std::atoi(argv[i + 1])) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--min-time") && i + 1 < argc && (min_time = std::atof(argv[i + 1]) / 1000) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			config.threads = std::atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--large")) {
+			config.large = true;
+		} else if (!strcmp(argv[i], "--data") && i + 1 < argc) {
+			config.data_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--tmp") && i + 1 < argc) {
+			config.temp_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+			json_path = argv[++i];
+		} else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+			baseline_path = argv[++i];
+		} else if (!strcmp(argv[i], "--threshold") && i + 1 < argc && (threshold = std::atof(argv[i + 1]) / 100) > 0) {
+			++i;
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--filter TEXT[,TEXT...]] [--list] [--repeats N] [--min-time MS] [--threads N] [--large] [--data DIR] [--tmp DIR] [--json FILE] [--baseline FILE] [--threshold PERCENT]\n";
+			return 2;
+		}
+	}
+
+	// read the baseline first, so a typo doesn't cost a whole run
+	std::map<std::string, BaselineEntry> baseline;
+	if (baseline_path && !read_baseline(baseline_path, baseline)) return 2;
+
+	std::vector<BenchResult> results;
+	auto header = false;
+	for (auto &b : all_benchmarks(config)) {
+		if (!matches(b.name, filter)) continue;
+		if (list) {
+			printf("%s\n", b.name.c_str());
+			continue;
+		}
+		if (!header) {
+			printf("%-40s %11s %11s %11s %7s  %s\n", "benchmark", "median", "min", "mean", "stddev", "throughput");
+			header = true;
+		}
+		results.push_back(run_benchmark(b, repeats, min_time));
+		print_result(results.back());
+	}
+	if (list) return 0;
+
+	if (json_path && !write_json(json_path, results)) return 2;
+	if (baseline_path && compare(results, baseline, threshold) > 0) return 1;
+	return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// a benchmark is a name and a factory. the factory does all the setup (loading, generating
+// meshes, ...) and hands back the work to time, so nothing is built for benchmarks that were
+// filtered out, and setup never ends up in the numbers
+struct BenchCase {
+	long long items;           // how much one run of body does, for throughput. 0 for none
+	const char *unit;          // what items are: "pixels", "triangles", ...
+	std::function<void()> body;
+};
+
+typedef std::function<BenchCase()> BenchFactory;
+
+struct Benchmark {
+	std::string name; // "group/what/size", filters match any part of it
+	BenchFactory factory;
+};
+
+// where benchmarks get their inputs and how hard they're run
+struct BenchConfig {
+	std::string data_dir; // the bundled model and texture
+	std::string temp_dir; // scratch files for the file format benchmarks
+	int threads;          // macro benchmarks render on this many, 1 by default so runs repeat
+	bool large;           // include the biggest synthetic meshes
+};
+
+// every benchmark there is, in the order they run
+std::vector<Benchmark> all_benchmarks(const BenchConfig &config);
+
+// stop the compiler from throwing away a result nobody reads
+template <class T>
+inline void keep(const T &value) {
+#if defined(__GNUC__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+#endif //__BENCH_H__
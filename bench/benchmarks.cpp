@@ -0,0 +1,303 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "synthetic.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "mapped_file.h"
+#include "model.h"
+#include "obj_loader.h"
+#include "pipeline.h"
+#include "texture.h"
+#include "tga_rle.h"
+#include "tgaimage.h"
+#include "thread_pool.h"
+#include "transform_simd.h"
+#include "util.h"
+#include "vertex_stage.h"
+#include "yuv.h"
+
+// the synthetic mesh sizes, the last only with --large
+struct SphereSize {
+	const char *name;
+	long long triangles;
+};
+static const SphereSize SPHERES[] = {{"10k", 10000}, {"100k", 100000}, {"1m", 1000000}, {"10m", 10000000}};
+static const int LARGE_SPHERES = 1; // how many of the end of SPHERES need --large
+
+static std::string head_obj(const BenchConfig &config) {
+	return config.data_dir + "/african_head.obj";
+}
+
+static std::string head_texture(const BenchConfig &config) {
+	return config.data_dir + "/african_head_diffuse.tga";
+}
+
+static std::shared_ptr<TGAImage> load_tga(const std::string &path) {
+	auto image = std::make_shared<TGAImage>();
+	image->read_tga_file(path.c_str());
+	return image;
+}
+
+static long long file_size(const std::string &path) {
+	MappedFile file;
+	return file.open(path.c_str()) ? static_cast<long long>(file.size()) : 0;
+}
+
+// everything a whole frame needs, kept alive by the benchmark body
+struct Scene {
+	std::unique_ptr<Model> model;
+	Texture texture;
+	Camera camera;
+	std::unique_ptr<ThreadPool> pool;
+	std::unique_ptr<Framebuffer> fb;
+};
+
+// a frame of model drawn width x height, textured and lit like the renderer's default, without
+// writing the image out
+static BenchCase render_case(const BenchConfig &config, std::unique_ptr<Model> model, int width, int height, long long items, const char *unit) {
+	auto scene = std::make_shared<Scene>();
+	scene->model = std::move(model);
+	auto diffuse = load_tga(head_texture(config));
+	diffuse->flip_vertically();
+	scene->texture = Texture(*diffuse);
+	scene->pool.reset(new ThreadPool(config.threads));
+	scene->fb.reset(new Framebuffer(width, height, TILE_SIZE));
+	auto options = RasterOptions{detect_raster_isa(), true, false, true};
+	auto light = Vec3f(3, 0, 1).normalize();
+	return BenchCase{items, unit, [scene, options, light]() {
+		RenderStats stats;
+		scene->fb->clear(TGAColor(200, 200, 200, 255));
+		draw_scene(SHADE_TEXTURED_PHONG, *scene->model, scene->camera, scene->texture, light, *scene->fb, *scene->pool, options, stats);
+		scene->fb->resolve();
+	}};
+}
+
+static void add_micro(const BenchConfig &config, std::vector<Benchmark> &out) {
+	out.push_back({"micro/barycentric", []() {
+		// every pixel of a 256 x 256 square against a triangle across it
+		const int SIDE = 256;
+		auto v0 = Vec3f(10, 20, 0.5f), v1 = Vec3f(240, 60, 0.25f), v2 = Vec3f(90, 250, 0.75f);
+		return BenchCase{SIDE * SIDE, "points", [=]() {
+			for (auto y = 0; y < SIDE; ++y) {
+				for (auto x = 0; x < SIDE; ++x) {
+					auto weights = barycentric(Vec2i(x, y), v0, v1, v2);
+					keep(weights);
+				}
+			}
+		}};
+	}});
+
+	// what convert_to_screen_coordinates used to do, now the vertex stage
+	auto vertex_stage = [](std::shared_ptr<Model> model) {
+		auto out = std::make_shared<ScreenVertices>();
+		auto m = Camera().screen_matrix(1024, 1024);
+		return BenchCase{model->nverts(), "vertices", [=]() {
+			transform_vertices(detect_raster_isa(), model->mesh(), m, 1024, 1024, *out, nullptr);
+			keep(out->x[0]);
+		}};
+	};
+	out.push_back({"micro/transform_vertices/head", [=]() {
+		return vertex_stage(std::make_shared<Model>(head_obj(config).c_str()));
+	}});
+	out.push_back({"micro/transform_vertices/sphere_1m", [=]() {
+		return vertex_stage(std::make_shared<Model>(make_sphere(1000000)));
+	}});
+
+	for (auto isa : {RASTER_SCALAR, RASTER_SSE41, RASTER_AVX2}) {
+		if (isa > detect_raster_isa()) continue;
+		out.push_back({std::string("micro/transform_points/") + raster_isa_name(isa), [=]() {
+			const int N = 65536;
+			auto in = std::make_shared<std::vector<float>>(3 * N);
+			auto result = std::make_shared<std::vector<float>>(4 * N);
+			for (auto i = 0; i < 3 * N; ++i) (*in)[i] = float(i % 977) / 977 - 0.5f;
+			auto m = Camera().screen_matrix(1024, 1024);
+			return BenchCase{N, "points", [=]() {
+				auto p = in->data();
+				auto o = result->data();
+				transform_points(isa, m, N, p, p + N, p + 2 * N, o, o + N, o + 2 * N, o + 3 * N);
+				keep(o[0]);
+			}};
+		}});
+	}
+
+	for (auto isa : {RASTER_SCALAR, RASTER_SSE41, RASTER_AVX2}) {
+		if (isa > detect_raster_isa()) continue;
+		out.push_back({std::string("micro/yuv420/") + raster_isa_name(isa), [=]() {
+			const int W = 1024;
+			auto in = std::make_shared<std::vector<unsigned char>>(6 * W);
+			auto result = std::make_shared<std::vector<unsigned char>>(3 * W);
+			for (auto i = 0; i < 6 * W; ++i) (*in)[i] = static_cast<unsigned char>(i * 7 % 251);
+			return BenchCase{2 * W, "pixels", [=]() {
+				auto p = in->data();
+				auto o = result->data();
+				bgr_to_yuv420(isa, p, p + 3 * W, W, o, o + W, o + 2 * W, o + 2 * W + W / 2);
+				keep(o[0]);
+			}};
+		}});
+	}
+
+	out.push_back({"micro/tga_get", [=]() {
+		auto image = load_tga(head_texture(config));
+		auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+		return BenchCase{pixels, "pixels", [image]() {
+			unsigned int sum = 0;
+			for (auto y = 0; y < image->get_height(); ++y) {
+				for (auto x = 0; x < image->get_width(); ++x) sum += image->get(x, y).val;
+			}
+			keep(sum);
+		}};
+	}});
+	out.push_back({"micro/tga_set", [=]() {
+		auto image = std::make_shared<TGAImage>(1024, 1024, TGAImage::RGB);
+		return BenchCase{1024 * 1024, "pixels", [image]() {
+			for (auto y = 0; y < 1024; ++y) {
+				for (auto x = 0; x < 1024; ++x) image->set(x, y, TGAColor(x & 255, y & 255, (x ^ y) & 255, 255));
+			}
+			keep(*image->buffer());
+		}};
+	}});
+
+	// the output encoders in memory (tga rle, and qoi, ppm and y4m to hold it against), the rle decoder,
+	// then whole tga files through temp_dir, for a photo-like image (the texture) and a rendered
+	// frame with big flat areas
+	auto rendered = [=]() {
+		Framebuffer fb(1024, 1024, TILE_SIZE);
+		Model model(head_obj(config).c_str());
+		auto diffuse = load_tga(head_texture(config));
+		diffuse->flip_vertically();
+		Texture texture(*diffuse);
+		ThreadPool pool(1);
+		RenderStats stats;
+		fb.clear(TGAColor(200, 200, 200, 255));
+		draw_scene(SHADE_TEXTURED_PHONG, model, Camera(), texture, Vec3f(3, 0, 1).normalize(), fb, pool, RasterOptions{detect_raster_isa(), true, false, true}, stats);
+		fb.resolve();
+		return std::make_shared<TGAImage>(fb.get_image());
+	};
+	auto images = std::vector<std::pair<std::string, std::function<std::shared_ptr<TGAImage>()>>>{
+		{"texture", [=]() { return load_tga(head_texture(config)); }},
+		{"render", rendered}
+	};
+	for (auto &source : images) {
+		auto name = source.first;
+		auto make = source.second;
+		auto path = config.temp_dir + "/renderer_bench_" + name + ".tga";
+		out.push_back({"micro/rle_encode/" + name, [=]() {
+			auto image = make();
+			auto encoded = std::make_shared<std::vector<unsigned char>>();
+			auto pool = std::make_shared<ThreadPool>(config.threads);
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				encoded->clear();
+				rle_encode(image->buffer(), image->get_width(), image->get_height(), image->get_bytespp(), *encoded, pool.get());
+				keep(encoded->size());
+			}};
+		}});
+		out.push_back({"micro/qoi_encode/" + name, [=]() {
+			auto image = make();
+			auto encoded = std::make_shared<std::vector<unsigned char>>();
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				encoded->clear();
+				qoi_encode(image->buffer(), image->get_width(), image->get_height(), image->get_bytespp(), true, *encoded);
+				keep(encoded->size());
+			}};
+		}});
+		out.push_back({"micro/ppm_encode/" + name, [=]() {
+			auto image = make();
+			auto encoded = std::make_shared<std::vector<unsigned char>>();
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				encoded->clear();
+				pnm_encode(image->buffer(), image->get_width(), image->get_height(), image->get_bytespp(), true, false, *encoded);
+				keep(encoded->size());
+			}};
+		}});
+		out.push_back({"micro/y4m_encode/" + name, [=]() {
+			auto image = make();
+			auto encoded = std::make_shared<std::vector<unsigned char>>();
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				encoded->clear();
+				y4m_encode_frame(image->buffer(), image->get_width(), image->get_height(), image->get_bytespp(), true, *encoded);
+				keep(encoded->size());
+			}};
+		}});
+		out.push_back({"micro/rle_decode/" + name, [=]() {
+			auto image = make();
+			auto encoded = std::make_shared<std::vector<unsigned char>>();
+			rle_encode(image->buffer(), image->get_width(), image->get_height(), image->get_bytespp(), *encoded);
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				auto in = encoded->data();
+				rle_decode(in, in + encoded->size(), image->buffer(), pixels, image->get_bytespp());
+				keep(*image->buffer());
+			}};
+		}});
+		out.push_back({"micro/tga_write/" + name, [=]() {
+			auto image = make();
+			auto pool = std::make_shared<ThreadPool>(config.threads);
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				image->write_tga_file(path.c_str(), true, pool.get());
+			}};
+		}});
+		out.push_back({"micro/tga_read/" + name, [=]() {
+			auto image = make();
+			image->write_tga_file(path.c_str(), true);
+			auto pixels = static_cast<long long>(image->get_width()) * image->get_height();
+			return BenchCase{pixels, "pixels", [=]() {
+				TGAImage in;
+				in.read_tga_file(path.c_str());
+				keep(*in.buffer());
+			}};
+		}});
+	}
+
+	out.push_back({"micro/obj_parse/head", [=]() {
+		auto path = head_obj(config);
+		return BenchCase{file_size(path), "bytes", [=]() {
+			MeshData mesh;
+			load_obj(path.c_str(), mesh);
+			keep(mesh.vfaces.size());
+		}};
+	}});
+	for (auto sphere : {SPHERES[1], SPHERES[2]}) {
+		out.push_back({std::string("micro/obj_parse/sphere_") + sphere.name, [=]() {
+			auto path = config.temp_dir + "/renderer_bench_sphere_" + sphere.name + ".obj";
+			write_obj(path.c_str(), make_sphere(sphere.triangles));
+			return BenchCase{file_size(path), "bytes", [=]() {
+				MeshData mesh;
+				load_obj(path.c_str(), mesh);
+				keep(mesh.vfaces.size());
+			}};
+		}});
+	}
+}
+
+static void add_macro(const BenchConfig &config, std::vector<Benchmark> &out) {
+	for (auto size : {512, 1024, 2048, 4096}) {
+		out.push_back({"macro/head/" + std::to_string(size), [=]() {
+			auto model = std::unique_ptr<Model>(new Model(head_obj(config).c_str()));
+			return render_case(config, std::move(model), size, size, static_cast<long long>(size) * size, "pixels");
+		}});
+	}
+	auto count = sizeof(SPHERES) / sizeof(SPHERES[0]) - (config.large ? 0 : LARGE_SPHERES);
+	for (size_t i = 0; i < count; ++i) {
+		auto sphere = SPHERES[i];
+		out.push_back({std::string("macro/sphere_") + sphere.name + "/1024", [=]() {
+			auto model = std::unique_ptr<Model>(new Model(make_sphere(sphere.triangles)));
+			auto triangles = model->nfaces();
+			return render_case(config, std::move(model), 1024, 1024, triangles, "triangles");
+		}});
+	}
+}
+
+std::vector<Benchmark> all_benchmarks(const BenchConfig &config) {
+	std::vector<Benchmark> out;
+	add_micro(config, out);
+	add_macro(config, out);
+	return out;
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include "synthetic.h"
+
+MeshData make_sphere(long long triangles) {
+	// 2 triangles per quad, rings * (2 * rings) quads
+	auto rings = std::max(2, static_cast<int>(std::lround(std::sqrt(triangles / 4.0))));
+	auto segments = 2 * rings;
+	const double pi = 3.14159265358979323846;
+
+	// a grid of (rings + 1) x (segments + 1) vertices, from the top pole down. the seam and the
+	// poles repeat vertices so texture coordinates can run 0 to 1 all the way
+	MeshData m;
+	auto nverts = static_cast<size_t>(rings + 1) * (segments + 1);
+	m.vx.reserve(nverts);
+	m.vy.reserve(nverts);
+	m.vz.reserve(nverts);
+	m.tu.reserve(nverts);
+	m.tv.reserve(nverts);
+	for (auto i = 0; i <= rings; ++i) {
+		auto theta = pi * i / rings;
+		for (auto j = 0; j <= segments; ++j) {
+			// longitude 0 faces +z, towards the default camera, and increases towards +x
+			auto phi = 2 * pi * j / segments;
+			m.vx.push_back(float(std::sin(theta) * std::sin(phi)));
+			m.vy.push_back(float(std::cos(theta)));
+			m.vz.push_back(float(std::sin(theta) * std::cos(phi)));
+			m.tu.push_back(float(j) / segments);
+			m.tv.push_back(1 - float(i) / rings);
+		}
+	}
+	// on a unit sphere the normal is the position
+	m.nx = m.vx;
+	m.ny = m.vy;
+	m.nz = m.vz;
+
+	// a top left, b below it, c below right, d right: a b c and a c d wind counter-clockwise
+	auto nindices = static_cast<size_t>(rings) * segments * 6;
+	m.vfaces.reserve(nindices);
+	for (auto i = 0; i < rings; ++i) {
+		for (auto j = 0; j < segments; ++j) {
+			auto a = i * (segments + 1) + j;
+			auto b = a + segments + 1;
+			auto c = b + 1;
+			auto d = a + 1;
+			for (auto v : {a, b, c, a, c, d}) m.vfaces.push_back(v);
+		}
+	}
+	// every vertex carries its own texture coordinate and normal
+	m.vtfaces = m.vfaces;
+	m.vnfaces = m.vfaces;
+	return m;
+}
+
+bool write_obj(const char *filename, const MeshData &mesh) {
+	auto f = fopen(filename, "w");
+	if (!f) {
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+	for (size_t i = 0; i < mesh.vx.size(); ++i) fprintf(f, "v %.6f %.6f %.6f\n", mesh.vx[i], mesh.vy[i], mesh.vz[i]);
+	for (size_t i = 0; i < mesh.tu.size(); ++i) fprintf(f, "vt %.6f %.6f 0\n", mesh.tu[i], mesh.tv[i]);
+	for (size_t i = 0; i < mesh.nx.size(); ++i) fprintf(f, "vn %.6f %.6f %.6f\n", mesh.nx[i], mesh.ny[i], mesh.nz[i]);
+	for (size_t i = 0; i + 2 < mesh.vfaces.size(); i += 3) {
+		fprintf(f, "f");
+		for (auto k = 0; k < 3; ++k) {
+			fprintf(f, " %d/%d/%d", mesh.vfaces[i + k] + 1, mesh.vtfaces[i + k] + 1, mesh.vnfaces[i + k] + 1);
+		}
+		fprintf(f, "\n");
+	}
+	auto ok = !ferror(f);
+	if (fclose(f) != 0) ok = false;
+	if (!ok) std::cerr << "can't write file " << filename << "\n";
+	return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef __SYNTHETIC_H__
+#define __SYNTHETIC_H__
+
+#include "mesh.h"
+
+// a unit sphere around the origin cut into about triangles triangles (rings of latitude twice as
+// many segments of longitude around), with texture coordinates and normals. counter-clockwise
+// from outside, and always exactly the same for the same count, so benchmarks repeat
+MeshData make_sphere(long long triangles);
+
+// write mesh out as an .obj with v/vt/vn faces. false (and a message) if it can't
+bool write_obj(const char *filename, const MeshData &mesh);
+
+#endif //__SYNTHETIC_H__
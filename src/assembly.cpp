@@ -0,0 +1,163 @@
+#include <algorithm>
+#include "assembly.h"
+#include "thread_pool.h"
+#include "util.h"
+
+// faces per parallel job
+static const int ASSEMBLY_BATCH = 4096;
+// clipping a triangle against every plane in CLIP_PLANES_TO_CLIP adds at most one vertex per plane
+static const int MAX_CLIPPED_VERTICES = 3 + 5;
+
+// a corner of a face on its way through clipping
+struct ClipVertex {
+	Vec4f p;
+	Vec2f uv;
+	Vec3f normal;
+};
+
+// the point t of the way from a to b, attributes and all
+static ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+	return ClipVertex{a.p + (b.p - a.p) * t, a.uv + (b.uv - a.uv) * t, a.normal + (b.normal - a.normal) * t};
+}
+
+// sutherland-hodgman: the part of polygon in (n corners) inside plane, into out. returns its size
+static int clip_polygon(const ClipVertex *in, int n, int plane, int width, int height, ClipVertex *out) {
+	auto m = 0;
+	for (auto i = 0; i < n; ++i) {
+		auto &cur = in[i];
+		auto &next = in[(i + 1) % n];
+		auto dc = clip_plane_distance(plane, cur.p, width, height);
+		auto dn = clip_plane_distance(plane, next.p, width, height);
+		if (dc >= 0) out[m++] = cur;
+		if ((dc >= 0) != (dn >= 0)) out[m++] = lerp(cur, next, dc / (dc - dn));
+	}
+	return m;
+}
+
+// set up the triangle and keep it if it's worth rasterizing
+static void emit_triangle(ScreenTriangle &t, const Rect &screen, bool cull_back_faces, std::vector<ScreenTriangle> &out, RenderStats &stats) {
+	// set up the edge functions once, so any covered pixel can be found (or revisited) cheaply
+	if (!setup_triangle(t.a, t.b, t.c, t.setup)) {
+		stats.triangles_empty++;
+		return;
+	}
+	if (cull_back_faces && !t.setup.counter_clockwise) {
+		stats.triangles_back_facing++;
+		return;
+	}
+	t.setup.bounds = t.setup.bounds.intersect(screen);
+	if (t.setup.bounds.empty()) {
+		stats.triangles_empty++;
+		return;
+	}
+	out.push_back(t);
+	stats.triangles_assembled++;
+}
+
+// assemble face i of mesh from its already transformed vertices
+static void assemble_face(const MeshView &mesh, const ScreenVertices &vertices, int i, int width, int height, bool cull_back_faces, std::vector<ScreenTriangle> &out, RenderStats &stats) {
+	auto v = mesh.vfaces + 3 * i;
+	auto vt = mesh.vtfaces + 3 * i;
+	auto vn = mesh.vnfaces + 3 * i;
+	stats.faces_in++;
+
+	// all three corners outside the same plane: nothing of it can be seen
+	int codes[3] = {vertices.outcode[v[0]], vertices.outcode[v[1]], vertices.outcode[v[2]]};
+	if (codes[0] & codes[1] & codes[2]) {
+		stats.faces_outside++;
+		return;
+	}
+
+	ScreenTriangle t;
+	// (at, bt, ct) describes the (u, v) position of each vertex's corresponding texel
+	// a missing one reads as (0, 0)
+	Vec2f *uvs[3] = {&t.at, &t.bt, &t.ct};
+	for (auto k = 0; k < 3; ++k) {
+		*uvs[k] = vt[k] >= 0 ? Vec2f(mesh.tu[vt[k]], mesh.tv[vt[k]]) : Vec2f();
+	}
+
+	// the face's normal, counter-clockwise being the front
+	Vec3f p[3];
+	for (auto k = 0; k < 3; ++k) p[k] = Vec3f(mesh.vx[v[k]], mesh.vy[v[k]], mesh.vz[v[k]]);
+	t.normal = cross_product(p[1] - p[0], p[2] - p[0]);
+	auto length = t.normal.norm();
+	t.normal = length > 0 ? t.normal * (1 / length) : Vec3f(0, 0, 1);
+
+	// (an, bn, cn) describes the vertices normal's, the face's own where there isn't one
+	Vec3f *normals[3] = {&t.an, &t.bn, &t.cn};
+	for (auto k = 0; k < 3; ++k) {
+		*normals[k] = vn[k] >= 0 ? Vec3f(mesh.nx[vn[k]], mesh.ny[vn[k]], mesh.nz[vn[k]]) : t.normal;
+	}
+
+	auto screen = Rect(0, 0, width, height);
+	auto crossing = (codes[0] | codes[1] | codes[2]) & CLIP_PLANES_TO_CLIP;
+	if (!crossing) {
+		// (a, b, c) describes the position of the face's vertices
+		t.a = vertices.get(v[0]);
+		t.b = vertices.get(v[1]);
+		t.c = vertices.get(v[2]);
+		t.inv_w = Vec3f(1 / vertices.w[v[0]], 1 / vertices.w[v[1]], 1 / vertices.w[v[2]]);
+		emit_triangle(t, screen, cull_back_faces, out, stats);
+		return;
+	}
+
+	// cut off whatever lies behind the near plane (or past the guard band) while w is still
+	// around to interpolate with, then fan the polygon that's left back into triangles
+	stats.faces_clipped++;
+	ClipVertex polygon[2][MAX_CLIPPED_VERTICES];
+	auto n = 3;
+	polygon[0][0] = ClipVertex{vertices.get_clip(v[0]), t.at, t.an};
+	polygon[0][1] = ClipVertex{vertices.get_clip(v[1]), t.bt, t.bn};
+	polygon[0][2] = ClipVertex{vertices.get_clip(v[2]), t.ct, t.cn};
+	auto current = 0;
+	for (auto plane = 1; plane <= CLIP_GUARD_TOP && n >= 3; plane <<= 1) {
+		if (!(crossing & plane)) continue;
+		n = clip_polygon(polygon[current], n, plane, width, height, polygon[1 - current]);
+		current = 1 - current;
+	}
+	auto &clipped = polygon[current];
+	for (auto k = 1; k + 1 < n; ++k) {
+		t.a = clipped[0].p.project();
+		t.b = clipped[k].p.project();
+		t.c = clipped[k + 1].p.project();
+		t.inv_w = Vec3f(1 / clipped[0].p.w, 1 / clipped[k].p.w, 1 / clipped[k + 1].p.w);
+		t.at = clipped[0].uv;
+		t.bt = clipped[k].uv;
+		t.ct = clipped[k + 1].uv;
+		t.an = clipped[0].normal;
+		t.bn = clipped[k].normal;
+		t.cn = clipped[k + 1].normal;
+		emit_triangle(t, screen, cull_back_faces, out, stats);
+	}
+}
+
+void assemble_triangles(const MeshView &mesh, const ScreenVertices &vertices, int width, int height, bool cull_back_faces, std::vector<ScreenTriangle> &out, RenderStats &stats, ThreadPool *pool) {
+	out.clear();
+	auto batches = (mesh.nfaces + ASSEMBLY_BATCH - 1) / ASSEMBLY_BATCH;
+	if (!pool || batches < 2) {
+		out.reserve(mesh.nfaces);
+		for (auto i = 0; i < mesh.nfaces; ++i) {
+			assemble_face(mesh, vertices, i, width, height, cull_back_faces, out, stats);
+		}
+		return;
+	}
+
+	// batches fill their own lists, which are joined in order afterwards
+	std::vector<std::vector<ScreenTriangle>> batch_out(batches);
+	std::vector<RenderStats> batch_stats(batches);
+	pool->parallel_for(batches, [&](int batch) {
+		auto first = batch * ASSEMBLY_BATCH;
+		auto last = std::min(first + ASSEMBLY_BATCH, mesh.nfaces);
+		batch_out[batch].reserve(last - first);
+		for (auto i = first; i < last; ++i) {
+			assemble_face(mesh, vertices, i, width, height, cull_back_faces, batch_out[batch], batch_stats[batch]);
+		}
+	});
+	size_t total = 0;
+	for (auto &b : batch_out) total += b.size();
+	out.reserve(total);
+	for (auto batch = 0; batch < batches; ++batch) {
+		out.insert(out.end(), batch_out[batch].begin(), batch_out[batch].end());
+		stats.add(batch_stats[batch]);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef __ASSEMBLY_H__
+#define __ASSEMBLY_H__
+
+#include <vector>
+#include "geometry.h"
+#include "mesh.h"
+#include "rasterizer.h"
+#include "stats.h"
+#include "vertex_stage.h"
+
+class ThreadPool;
+
+// a triangle on screen, set up for rasterizing, along with everything needed to shade it
+struct ScreenTriangle {
+	TriangleSetup setup;
+	Vec3f a, b, c;    // screen positions, z is depth
+	Vec3f inv_w;      // 1 / w at a b c, what perspective correct interpolation divides by
+	Vec2f at, bt, ct; // texture coordinates
+	Vec3f an, bn, cn; // vertex normals, in world space and not necessarily unit length
+	Vec3f normal;     // the face's own normal, in world space, unit length
+};
+
+// primitive assembly: turn every face of mesh into triangles ready for a width x height screen,
+// in face order. faces entirely outside the view are dropped on their vertices' outcodes alone,
+// faces crossing the near plane (or the guard band) are clipped in homogeneous coordinates,
+// back faces are dropped if cull_back_faces is set (counter-clockwise on screen is the front),
+// as is anything that covers no pixel. every bounding box is clamped to the screen.
+// corners without a normal of their own take the face's.
+// big meshes are split across pool, if given
+void assemble_triangles(const MeshView &mesh, const ScreenVertices &vertices, int width, int height, bool cull_back_faces, std::vector<ScreenTriangle> &out, RenderStats &stats, ThreadPool *pool = nullptr);
+
+#endif //__ASSEMBLY_H__
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <sys/stat.h>
+#include "asset_cache.h"
+
+// path and what the file is now, or "" if it isn't there
+static std::string file_key(const std::string &path) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) return std::string();
+	return path + "\n" + std::to_string(static_cast<long long>(st.st_mtim.tv_sec)) + "." + std::to_string(static_cast<long long>(st.st_mtim.tv_nsec)) + "\n" + std::to_string(static_cast<long long>(st.st_size));
+}
+
+AssetCache::AssetCache(size_t b, ThreadPool *p) : budget(b), used(0), hits_(0), misses_(0), pool(p) {
+}
+
+AssetCache::Entry *AssetCache::find(const std::string &key) {
+	auto i = index.find(key);
+	if (i == index.end()) return nullptr;
+	entries.splice(entries.begin(), entries, i->second);
+	return &entries.front();
+}
+
+AssetCache::Entry &AssetCache::insert(Entry entry) {
+	auto found = find(entry.key);
+	if (found) return *found;
+	used += entry.bytes;
+	entries.push_front(std::move(entry));
+	index[entries.front().key] = entries.begin();
+	while (used > budget && entries.size() > 1) {
+		auto &last = entries.back();
+		used -= last.bytes;
+		index.erase(last.key);
+		entries.pop_back();
+	}
+	return entries.front();
+}
+
+std::shared_ptr<Model> AssetCache::model(const std::string &path, bool &hit) {
+	auto key = file_key(path);
+	hit = false;
+	if (key.empty()) {
+		std::cerr << "can't open file " << path << "\n";
+		return nullptr;
+	}
+	key = "model\n" + key;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = find(key);
+		if (found) {
+			++hits_;
+			hit = true;
+			return found->model;
+		}
+		++misses_;
+	}
+
+	auto model = std::make_shared<Model>(path.c_str(), pool);
+	if (model->nfaces() == 0) {
+		std::cerr << "can't load a model from " << path << "\n";
+		return nullptr;
+	}
+	auto bytes = model->memory_size();
+	std::lock_guard<std::mutex> lock(mutex);
+	return insert(Entry{key, model, nullptr, bytes}).model;
+}
+
+std::shared_ptr<Texture> AssetCache::texture(const std::string &path, TextureFilter filter, TextureWrap wrap, bool &hit) {
+	auto key = file_key(path);
+	hit = false;
+	if (key.empty()) {
+		std::cerr << "can't open file " << path << "\n";
+		return nullptr;
+	}
+	key = std::string("texture ") + texture_filter_name(filter) + " " + texture_wrap_name(wrap) + "\n" + key;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = find(key);
+		if (found) {
+			++hits_;
+			hit = true;
+			return found->texture;
+		}
+		++misses_;
+	}
+
+	// as the renderer has always loaded its texture: v = 0 on the image's bottom row
+	TGAImage image;
+	if (!image.read_tga_file(path.c_str())) {
+		std::cerr << "can't read a tga from " << path << "\n";
+		return nullptr;
+	}
+	image.flip_vertically();
+	auto texture = std::make_shared<Texture>(image, filter, wrap);
+	auto bytes = texture->memory_size();
+	std::lock_guard<std::mutex> lock(mutex);
+	return insert(Entry{key, nullptr, texture, bytes}).texture;
+}
+
+size_t AssetCache::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return used;
+}
+
+int AssetCache::count() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return static_cast<int>(entries.size());
+}
+
+long long AssetCache::hits() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return hits_;
+}
+
+long long AssetCache::misses() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return misses_;
+}
@@ -0,0 +1,63 @@
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "model.h"
+#include "texture.h"
+
+class ThreadPool;
+
+// models and textures kept loaded between renders, so asking for the same file again costs a
+// stat() rather than a parse or a decode. entries are keyed by path and the file's modification
+// time and size, so a file that changes on disk is loaded afresh (the old entry just ages out).
+// textures also by how they're sampled, since that decides whether they carry mips.
+// once what's cached passes budget bytes the least recently used entries go, though never the
+// one just asked for. an evicted asset a render still holds lives on until that render's done.
+// safe to use from several threads at once; loads happen outside the lock, so a slow one never
+// holds up renders of assets already in
+class AssetCache {
+private:
+	struct Entry {
+		std::string key;
+		std::shared_ptr<Model> model;     // one of these two
+		std::shared_ptr<Texture> texture;
+		size_t bytes;
+	};
+
+	size_t budget;
+	size_t used;
+	long long hits_;
+	long long misses_;
+	ThreadPool *pool;
+	std::list<Entry> entries; // most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+	std::mutex mutex;
+
+	// the entry for key moved to the front, or nullptr
+	Entry *find(const std::string &key);
+	// add an entry (unless another thread got there first, then that one), then evict down to the budget
+	Entry &insert(Entry entry);
+public:
+	// .obj files are parsed on pool, if given
+	AssetCache(size_t budget, ThreadPool *pool = nullptr);
+	AssetCache(const AssetCache &) = delete;
+	AssetCache &operator=(const AssetCache &) = delete;
+
+	// the model at path, loaded if it isn't cached already (hit says which). nullptr (and a
+	// message) if it can't be loaded
+	std::shared_ptr<Model> model(const std::string &path, bool &hit);
+	// the tga at path as a texture sampled with filter and wrap, the same way
+	std::shared_ptr<Texture> texture(const std::string &path, TextureFilter filter, TextureWrap wrap, bool &hit);
+
+	size_t size();
+	int count();
+	long long hits();
+	long long misses();
+};
+
+#endif //__ASSET_CACHE_H__
@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <vector>
+#include "banded.h"
+
+ScreenTriangle band_triangle(const ScreenTriangle &t, int y0, int rows) {
+	auto b = t;
+	for (auto &e : b.setup.edges) e.c += e.b * y0;
+	auto r = t.setup.bounds.intersect(Rect(t.setup.bounds.x0, y0, t.setup.bounds.x1, y0 + rows));
+	b.setup.bounds = Rect(r.x0, r.y0 - y0, r.x1, r.y1 - y0);
+	return b;
+}
+
+bool render_banded(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, TGAColor background, int width, int height, int band_rows, DepthFormat format, ThreadPool &pool, const RasterOptions &options, ImageStream &out, RenderStats &stats) {
+	band_rows = std::max(1, std::min(band_rows, height));
+	std::vector<ScreenTriangle> triangles;
+	process_geometry(m, camera, width, height, pool, options, triangles, stats);
+
+	// every triangle into the bands its bounding box touches, in order
+	auto nbands = (height + band_rows - 1) / band_rows;
+	std::vector<std::vector<int>> bins(nbands);
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		auto &bounds = triangles[i].setup.bounds;
+		for (auto band = bounds.y0 / band_rows; band <= (bounds.y1 - 1) / band_rows; ++band) {
+			bins[band].push_back(static_cast<int>(i));
+		}
+	}
+
+	Framebuffer fb(width, band_rows, TILE_SIZE, format);
+	std::vector<ScreenTriangle> band_triangles;
+	for (auto k = 0; k < nbands; ++k) {
+		auto band = out.rows_bottom_up() ? k : nbands - 1 - k;
+		auto y0 = band * band_rows;
+		auto rows = std::min(band_rows, height - y0);
+		fb.resize(width, rows, format);
+		fb.set_origin_y(y0);
+		fb.clear(background);
+
+		band_triangles.clear();
+		for (auto i : bins[band]) band_triangles.push_back(band_triangle(triangles[i], y0, rows));
+		// done with it
+		std::vector<int>().swap(bins[band]);
+		draw_scene_triangles(mode, band_triangles, texture, towards_light, fb, pool, options, stats);
+
+		{
+			StageTimer timer(stats.times, STAGE_ENCODE);
+			fb.resolve();
+		}
+		StageTimer timer(stats.times, STAGE_WRITE);
+		if (!out.write_rows(fb.get_image().buffer(), rows, true)) return false;
+	}
+	return true;
+}
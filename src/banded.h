@@ -0,0 +1,28 @@
+#ifndef __BANDED_H__
+#define __BANDED_H__
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "model.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// t for a band starting at image row y0 and rows tall: its edge functions and bounds move into
+// the band's own rows, which only changes integers, so every pixel sees exactly the same edge
+// values (and so weights and depths) as it would in the whole image. the corners stay in image
+// rows for shading, which the framebuffer's origin puts back
+ScreenTriangle band_triangle(const ScreenTriangle &t, int y0, int rows);
+
+// render m into a width x height image band_rows rows at a time, each band drawn into a
+// framebuffer of its own size and streamed to out as soon as it's done, so memory goes with the
+// band rather than the image: posters far bigger than a whole framebuffer would fit in.
+// the geometry is transformed and assembled once for the whole image, then every triangle is
+// binned into the bands its bounding box touches, so a band only ever looks at its own.
+// bands go in the order out wants its rows. the image is identical to drawing the whole of it
+// with draw_scene on background and writing that
+bool render_banded(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, TGAColor background, int width, int height, int band_rows, DepthFormat format, ThreadPool &pool, const RasterOptions &options, ImageStream &out, RenderStats &stats);
+
+#endif //__BANDED_H__
@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include "batch.h"
+#include "frame_stream.h"
+#include "output_queue.h"
+
+std::vector<BatchFrame> orbit_frames(const BatchFrame &start, int n) {
+	std::vector<BatchFrame> frames;
+	auto offset = start.eye - start.target;
+	for (auto i = 0; i < n; ++i) {
+		auto angle = 2 * static_cast<float>(M_PI) * i / n;
+		auto c = std::cos(angle), s = std::sin(angle);
+		auto frame = start;
+		frame.eye = start.target + Vec3f(offset.x * c + offset.z * s, offset.y, offset.z * c - offset.x * s);
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+bool read_frame_list(const char *path, const BatchFrame &defaults, std::vector<BatchFrame> &frames) {
+	std::ifstream in(path);
+	if (!in.is_open()) {
+		std::cerr << "can't open file " << path << "\n";
+		return false;
+	}
+	std::string line;
+	for (auto number = 1; std::getline(in, line); ++number) {
+		auto comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		std::istringstream words(line);
+		std::string key, value;
+		auto frame = defaults;
+		auto any = false;
+		while (words >> key) {
+			Vec3f *v = key == "eye" ? &frame.eye : key == "look-at" ? &frame.target : key == "light" ? &frame.light : nullptr;
+			if (!v || !(words >> value) || sscanf(value.c_str(), "%f,%f,%f", &v->x, &v->y, &v->z) != 3) {
+				std::cerr << path << ":" << number << ": expected eye, look-at or light and X,Y,Z\n";
+				return false;
+			}
+			any = true;
+		}
+		if (any && !Camera::valid_view(frame.eye, frame.target)) {
+			std::cerr << path << ":" << number << ": the eye can't be where it looks\n";
+			return false;
+		}
+		if (any) frames.push_back(frame);
+	}
+	return true;
+}
+
+std::string numbered_path(const std::string &path, int frame) {
+	// only a %d, maybe with a width, is filled in. anything else with a % is just a name
+	auto percent = path.find('%');
+	if (percent != std::string::npos) {
+		auto end = path.find_first_not_of("0123456789", percent + 1);
+		if (end != std::string::npos && path[end] == 'd') {
+			auto spec = path.substr(percent + 1, end - percent - 1);
+			auto number = std::to_string(frame);
+			auto padding = spec.empty() ? 0 : std::atoi(spec.c_str()) - static_cast<int>(number.size());
+			if (padding > 0) number.insert(0, padding, spec[0] == '0' ? '0' : ' ');
+			return path.substr(0, percent) + number + path.substr(end + 1);
+		}
+	}
+	char number[32];
+	snprintf(number, sizeof(number), "_%04d", frame);
+	auto dot = path.find_last_of("./");
+	if (dot == std::string::npos || path[dot] != '.') return path + number;
+	return path.substr(0, dot) + number + path.substr(dot);
+}
+
+bool render_batch(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, TGAColor background, int width, int height, DepthFormat format,
+	ThreadPool &pool, const RasterOptions &options, const std::vector<BatchFrame> &frames, const std::string &output, ImageFormat image_format, int fps, RenderStats &stats) {
+	auto start = std::chrono::steady_clock::now();
+	auto streaming = FrameStream::streams(image_format);
+	FrameStream stream;
+	if (streaming && !stream.open(output.c_str(), image_format, width, height, TGAImage::RGB, fps)) return false;
+
+	auto nframes = static_cast<int>(frames.size());
+	auto frame_parallel = pool.size() > 1 && nframes >= pool.size();
+	// with a frame on every thread of pool the writer can't encode on it too, it'd wait for the
+	// frames and they for a buffer from it
+	OutputQueue queue(frame_parallel ? pool.size() + 1 : 2, TILE_SIZE, frame_parallel ? nullptr : &pool);
+
+	std::mutex mutex;
+	std::condition_variable turn;
+	auto next = 0; // the frame the stream wants next
+	auto draw = [&](int i, ThreadPool &frame_pool) {
+		RenderStats frame_stats;
+		auto view = camera;
+		view.look_at(frames[i].eye, frames[i].target);
+		auto light = frames[i].light;
+		auto &fb = queue.acquire(width, height, format);
+		fb.clear(background);
+		draw_scene(mode, m, view, texture, light.normalize(), fb, frame_pool, options, frame_stats);
+		{
+			StageTimer timer(frame_stats.times, STAGE_ENCODE);
+			fb.resolve();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		stats.add(frame_stats);
+		if (!streaming) {
+			lock.unlock();
+			queue.submit(fb, numbered_path(output, i), image_format);
+			return;
+		}
+		// frames finish in any order, the stream takes them in order. whoever's waiting holds a
+		// buffer, but there's always one more than there are threads
+		turn.wait(lock, [&] { return next == i; });
+		queue.submit(fb, stream);
+		++next;
+		turn.notify_all();
+	};
+
+	if (frame_parallel) {
+		pool.parallel_for(nframes, [&](int i) {
+			ThreadPool serial(1);
+			draw(i, serial);
+		});
+	} else {
+		for (auto i = 0; i < nframes; ++i) draw(i, pool);
+	}
+	auto ok = queue.finish();
+	stats.times.add(queue.write_times());
+	if (streaming) ok = stream.close() && ok;
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << "# " << nframes << " frames in " << seconds << " s, " << nframes / seconds << " frames/s"
+		<< (frame_parallel ? ", " + std::to_string(pool.size()) + " at once" : std::string()) << "\n";
+	return ok;
+}
@@ -0,0 +1,47 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "model.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// what changes from one frame of a batch to the next
+struct BatchFrame {
+	Vec3f eye;    // where the camera sits
+	Vec3f target; // what it looks at
+	Vec3f light;  // the light source, which points from here towards the origin
+};
+
+// n frames orbiting start's eye once around its target, about the vertical axis through it,
+// the first frame being start itself. the light stays where it is
+std::vector<BatchFrame> orbit_frames(const BatchFrame &start, int n);
+
+// frames from a text file, one per line: any of "eye X,Y,Z", "look-at X,Y,Z" and "light X,Y,Z",
+// in any order, what's left out coming from defaults. blank lines and everything after a # are
+// skipped. false (and a message) if the file can't be read or a line makes no sense
+bool read_frame_list(const char *path, const BatchFrame &defaults, std::vector<BatchFrame> &frames);
+
+// the file frame i goes to: path with a printf style %d (with a width, like %04d) filled in, or
+// with _0000 style numbering put in front of its extension if it has no %d
+std::string numbered_path(const std::string &path, int frame);
+
+// render every frame, with camera's projection, loading nothing: the model and texture are
+// shared by all of them. with more frames than threads, whole frames are drawn at once, one per
+// thread of pool (each drawn serially, so no two fight over the pool), into framebuffers borrowed
+// from a pool of one more than that, recycled as soon as each is written. frame-level
+// parallelism scales better than splitting every frame into tiles, there's no binning or
+// waiting on the slowest tile. otherwise frames go one after another, each drawn on all of pool.
+// formats FrameStream takes are written as one stream to output, in order, at fps; anything
+// else as a file per frame, numbered_path(output, i). stats gets every frame's counters and
+// times added up, so stages overlapping on different threads add up to more than the wall time
+bool render_batch(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, TGAColor background, int width, int height, DepthFormat format,
+	ThreadPool &pool, const RasterOptions &options, const std::vector<BatchFrame> &frames, const std::string &output, ImageFormat image_format, int fps, RenderStats &stats);
+
+#endif //__BATCH_H__
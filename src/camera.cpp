@@ -0,0 +1,132 @@
+#include <cmath>
+#include <limits>
+#include "camera.h"
+#include "util.h"
+
+Mat4f look_at(Vec3f eye, Vec3f center, Vec3f up) {
+	// the camera's axes in world space
+	auto z = (eye - center).normalize();
+	auto x = cross_product(up, z);
+	// looking straight along up leaves which way is right undecided, so stand up on whichever
+	// world axis is least in line with the view instead (-z, looking straight down on y up)
+	if (!(x.norm() > 1e-6f * up.norm())) {
+		auto ax = std::abs(z.x), ay = std::abs(z.y), az = std::abs(z.z);
+		auto fallback = az <= ax && az <= ay ? Vec3f(0, 0, -1) : ax <= ay ? Vec3f(1, 0, 0) : Vec3f(0, 1, 0);
+		x = cross_product(fallback, z);
+	}
+	x.normalize();
+	auto y = cross_product(z, x);
+	Mat4f m;
+	for (auto i = 0; i < 3; ++i) {
+		m[0][i] = x.raw[i];
+		m[1][i] = y.raw[i];
+		m[2][i] = z.raw[i];
+	}
+	m[0][3] = -(x * eye);
+	m[1][3] = -(y * eye);
+	m[2][3] = -(z * eye);
+	return m;
+}
+
+Mat4f perspective(float fov_x, float fov_y, float near, float far) {
+	// w is the distance in front of the camera, d. depth = a + b / d with depth(near) = 1 and
+	// depth(far) = 0, which for an infinite far plane is just near / d
+	auto a = std::isinf(far) ? 0.0 : -double(near) / (double(far) - near);
+	auto b = std::isinf(far) ? double(near) : double(near) * far / (double(far) - near);
+	Mat4f m;
+	m[0][0] = float(1 / std::tan(fov_x / 2.0));
+	m[1][1] = float(1 / std::tan(fov_y / 2.0));
+	// z = -a * z_view + b, w = -z_view
+	m[2][2] = float(-a);
+	m[2][3] = float(b);
+	m[3][2] = -1;
+	m[3][3] = 0;
+	return m;
+}
+
+Mat4f orthographic(float width, float height, float near, float far) {
+	// depth = (far - d) / (far - near), with d = -z_view
+	Mat4f m;
+	m[0][0] = 2 / width;
+	m[1][1] = 2 / height;
+	m[2][2] = float(1 / (double(far) - near));
+	m[2][3] = float(double(far) / (double(far) - near));
+	return m;
+}
+
+Mat4f viewport(float x, float y, float width, float height) {
+	Mat4f m;
+	m[0][0] = width / 2;
+	m[0][3] = x + width / 2;
+	m[1][1] = height / 2;
+	m[1][3] = y + height / 2;
+	return m;
+}
+
+Camera::Camera() : eye(0, 0, 4), center(0, 0, 0), up(0, 1, 0), kind(PROJECTION_PERSPECTIVE),
+	fov(float(2 * std::atan(0.25))), size(2), near(2), far(std::numeric_limits<float>::infinity()) {
+}
+
+bool Camera::valid_view(Vec3f e, Vec3f c) {
+	auto d = e - c;
+	return std::isfinite(d.x) && std::isfinite(d.y) && std::isfinite(d.z) && d.norm() > 0;
+}
+
+bool Camera::valid_fov(float fov_degrees) {
+	return fov_degrees > 0 && fov_degrees < 180;
+}
+
+void Camera::look_at(Vec3f e, Vec3f c, Vec3f u) {
+	eye = e;
+	center = c;
+	up = u;
+}
+
+void Camera::set_perspective(float fov_degrees, float n, float f) {
+	kind = PROJECTION_PERSPECTIVE;
+	fov = float(fov_degrees * M_PI / 180);
+	near = n;
+	far = f;
+}
+
+void Camera::set_orthographic(float s, float n, float f) {
+	kind = PROJECTION_ORTHOGRAPHIC;
+	size = s;
+	near = n;
+	far = f;
+}
+
+void Camera::set_clip_planes(float n, float f) {
+	near = n;
+	far = f;
+}
+
+Mat4f Camera::view() const {
+	return ::look_at(eye, center, up);
+}
+
+Mat4f Camera::projection(int width, int height) const {
+	// stretch the smaller side's extent over the longer one
+	auto sx = width > height ? double(width) / height : 1.0;
+	auto sy = height > width ? double(height) / width : 1.0;
+	if (kind == PROJECTION_ORTHOGRAPHIC) {
+		// an orthographic depth range has to be finite. without one, reach as far past the
+		// center as the eye is in front of it
+		auto f = std::isinf(far) ? near + 2 * (eye - center).norm() : far;
+		return orthographic(float(size * sx), float(size * sy), near, f);
+	}
+	auto half = std::tan(fov / 2.0);
+	return perspective(float(2 * std::atan(half * sx)), float(2 * std::atan(half * sy)), near, far);
+}
+
+Mat4f Camera::screen_matrix(int width, int height) const {
+	return viewport(0, 0, float(width), float(height)) * projection(width, height) * view();
+}
+
+ProjectionKind Camera::get_kind() const {
+	return kind;
+}
+
+Vec3f Camera::get_eye() const {
+	return eye;
+}
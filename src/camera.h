@@ -0,0 +1,62 @@
+#ifndef __CAMERA_H__
+#define __CAMERA_H__
+
+#include "geometry.h"
+
+// the view matrix of a camera at eye looking towards center. the camera looks down its -z axis
+// with up along +y, as in opengl. looking straight along up, a world axis stands in for it
+Mat4f look_at(Vec3f eye, Vec3f center, Vec3f up);
+
+// projection matrices. depth is reversed: after dividing by w, z is 1 on the near plane and falls
+// towards 0 on the far plane, which is what the depth buffer wants (bigger is nearer).
+// x and y come out in [-1, 1] across the view.
+// fov_x and fov_y are the angles the view spans, in radians. far may be infinite
+Mat4f perspective(float fov_x, float fov_y, float near, float far);
+// width and height are the size of the view in world units, far has to be finite
+Mat4f orthographic(float width, float height, float near, float far);
+
+// maps x and y from [-1, 1] onto a width x height rectangle with its corner at (x, y)
+Mat4f viewport(float x, float y, float width, float height);
+
+enum ProjectionKind {
+	PROJECTION_PERSPECTIVE,
+	PROJECTION_ORTHOGRAPHIC
+};
+
+// where the model is seen from and how it's projected onto the framebuffer.
+// the field of view (or the orthographic view's size) spans the smaller side of the framebuffer,
+// the longer side just sees more
+class Camera {
+private:
+	Vec3f eye;
+	Vec3f center;
+	Vec3f up;
+	ProjectionKind kind;
+	float fov;  // perspective: radians across the smaller side
+	float size; // orthographic: world units across the smaller side
+	float near;
+	float far;
+public:
+	// the renderer's original view: 4 units up the z axis looking at the origin, with a focal
+	// length of 4 (the unit square fills the view) and depth = 2 / distance
+	Camera();
+	// whether a camera at eye can look at center: apart, with the way between them finite
+	static bool valid_view(Vec3f eye, Vec3f center);
+	// whether a perspective view can span fov_degrees: more than 0 and less than 180
+	static bool valid_fov(float fov_degrees);
+	void look_at(Vec3f eye, Vec3f center, Vec3f up = Vec3f(0, 1, 0));
+	// fov in degrees, far may be infinite
+	void set_perspective(float fov_degrees, float near, float far);
+	void set_orthographic(float size, float near, float far);
+	void set_clip_planes(float near, float far);
+
+	Mat4f view() const;
+	Mat4f projection(int width, int height) const;
+	// world space straight to screen space (before the divide by w) for a width x height framebuffer
+	Mat4f screen_matrix(int width, int height) const;
+
+	ProjectionKind get_kind() const;
+	Vec3f get_eye() const;
+};
+
+#endif //__CAMERA_H__
@@ -0,0 +1,84 @@
+#include <iostream>
+#include "frame_stream.h"
+
+FrameStream::FrameStream() : format(IMAGE_Y4M), width(0), height(0), bytespp(0), frames(0), out(nullptr) {
+}
+
+bool FrameStream::streams(ImageFormat format) {
+	return format == IMAGE_Y4M || format == IMAGE_PAM || format == IMAGE_PPM;
+}
+
+bool FrameStream::open(const char *filename, ImageFormat f, int w, int h, int bpp, int fps) {
+	format = f;
+	width = w;
+	height = h;
+	bytespp = bpp;
+	frames = 0;
+	name = filename;
+	out = nullptr;
+	if (!streams(format)) {
+		std::cerr << image_format_name(format) << " can't be streamed, only y4m, pam or ppm\n";
+		return false;
+	}
+	if (name == "-") {
+		out = &std::cout;
+	} else {
+		file.open(filename, std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "can't open file " << filename << "\n";
+			return false;
+		}
+		out = &file;
+	}
+
+	buffer.clear();
+	if (format == IMAGE_Y4M) y4m_encode_header(width, height, fps, buffer);
+	return flush();
+}
+
+bool FrameStream::flush() {
+	out->write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	buffer.clear();
+	// push each frame on to whoever's reading rather than leaving it in the stream's buffer
+	out->flush();
+	if (!out->good()) {
+		std::cerr << "can't write file " << name << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool FrameStream::write_frame(const unsigned char *pixels, bool bottom_up) {
+	if (!out) return false;
+	encode_frame(pixels, bottom_up);
+	return write_encoded();
+}
+
+void FrameStream::encode_frame(const unsigned char *pixels, bool bottom_up) {
+	if (format == IMAGE_Y4M) {
+		y4m_encode_frame(pixels, width, height, bytespp, bottom_up, buffer);
+	} else {
+		pnm_encode(pixels, width, height, bytespp, bottom_up, format == IMAGE_PAM, buffer);
+	}
+	++frames;
+}
+
+bool FrameStream::write_encoded() {
+	if (!out) return false;
+	return flush();
+}
+
+int FrameStream::frame_count() const {
+	return frames;
+}
+
+bool FrameStream::close() {
+	if (!out) return false;
+	auto ok = bool(out->flush());
+	if (out == &file) {
+		file.close();
+		ok = ok && !file.fail();
+	}
+	out = nullptr;
+	return ok;
+}
@@ -0,0 +1,45 @@
+#ifndef __FRAME_STREAM_H__
+#define __FRAME_STREAM_H__
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "image_formats.h"
+
+// frames written one after another to a single file, stdout ("-") or a named pipe, for a video
+// encoder or anything else to read as they come: y4m (a header, then each frame as yuv 4:2:0),
+// or pam or ppm (each frame a whole netpbm image, which is how ffmpeg's image2pipe and friends
+// take them). each frame is encoded straight from the pixels into a buffer that's kept from one
+// frame to the next and written with one call, nothing else is copied
+class FrameStream {
+private:
+	ImageFormat format;
+	int width;
+	int height;
+	int bytespp;
+	int frames;
+	std::ofstream file;
+	std::ostream *out;
+	std::string name;
+	std::vector<unsigned char> buffer; // one frame's encoding, reused
+
+	bool flush();
+public:
+	FrameStream();
+	// start a stream of width x height frames of bytespp byte pixels, fps a second (which only y4m
+	// records). false (and a message) if the file can't be opened or format isn't y4m, pam or ppm.
+	// opening a pipe waits for its reader
+	bool open(const char *filename, ImageFormat format, int width, int height, int bytespp, int fps = 30);
+	// whether format can be streamed
+	static bool streams(ImageFormat format);
+	// the next frame, width x height pixels, row 0 at the bottom if bottom_up like a framebuffer
+	bool write_frame(const unsigned char *pixels, bool bottom_up);
+	// write_frame in two steps, to time them apart: encode the next frame, then write it out
+	void encode_frame(const unsigned char *pixels, bool bottom_up);
+	bool write_encoded();
+	int frame_count() const;
+	// flush and close. false if any of it couldn't be written
+	bool close();
+};
+
+#endif //__FRAME_STREAM_H__
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+#include "framebuffer.h"
+
+const char *depth_format_name(DepthFormat format) {
+	return format == DEPTH_UNORM24 ? "unorm24" : "float";
+}
+
+DepthFormat parse_depth_format(const char *name) {
+	return !strcmp(name, "unorm24") ? DEPTH_UNORM24 : DEPTH_FLOAT32;
+}
+
+Framebuffer::Framebuffer(int w, int h, int tile, DepthFormat format) : width(0), height(0), origin_y(0), tile_size(tile), cols(0), rows(0), depth_format(format), clear_color(0, 0, 0, 255), hiz_cols(0), hiz_rows(0) {
+	resize(w, h, format);
+}
+
+void Framebuffer::resize(int w, int h, DepthFormat format) {
+	depth_format = format;
+	if (w == width && h == height) return;
+	width = w;
+	height = h;
+	cols = (width + tile_size - 1) / tile_size;
+	rows = (height + tile_size - 1) / tile_size;
+	color = TGAImage(width, height, TGAImage::RGB);
+	depth.assign(static_cast<size_t>(width) * height, 0);
+	pending_clear.assign(cols * rows, 0);
+	hiz_cols = (width + HIZ_BLOCK - 1) / HIZ_BLOCK;
+	hiz_rows = (height + HIZ_BLOCK - 1) / HIZ_BLOCK;
+	hiz.assign(hiz_cols * hiz_rows, 0);
+}
+
+int Framebuffer::get_width() {
+	return width;
+}
+
+int Framebuffer::get_height() {
+	return height;
+}
+
+DepthFormat Framebuffer::get_depth_format() {
+	return depth_format;
+}
+
+int Framebuffer::get_origin_y() {
+	return origin_y;
+}
+
+void Framebuffer::set_origin_y(int y) {
+	origin_y = y;
+}
+
+void Framebuffer::clear(TGAColor c) {
+	clear_color = c;
+	std::fill(pending_clear.begin(), pending_clear.end(), 1);
+}
+
+// fill one tile with whole-row copies instead of a pixel at a time
+void Framebuffer::clear_tile(int tile) {
+	pending_clear[tile] = 0;
+	auto x0 = (tile % cols) * tile_size;
+	auto y0 = (tile / cols) * tile_size;
+	auto x1 = std::min(x0 + tile_size, width);
+	auto y1 = std::min(y0 + tile_size, height);
+	auto row_bytes = (x1 - x0) * 3;
+	auto data = color.buffer();
+
+	// build the first row a pixel at a time, then copy it down
+	auto first = data + (x0 + y0 * width) * 3;
+	for (auto x = 0; x < x1 - x0; ++x) {
+		memcpy(first + x * 3, clear_color.raw, 3);
+	}
+	for (auto y = y0 + 1; y < y1; ++y) {
+		memcpy(data + (x0 + y * width) * 3, first, row_bytes);
+	}
+	for (auto y = y0; y < y1; ++y) {
+		auto row = depth.data() + x0 + static_cast<size_t>(y) * width;
+		std::fill(row, row + (x1 - x0), 0);
+	}
+	for (auto by = y0 / HIZ_BLOCK; by < (y1 + HIZ_BLOCK - 1) / HIZ_BLOCK; ++by) {
+		auto row = hiz.data() + by * hiz_cols;
+		std::fill(row + x0 / HIZ_BLOCK, row + (x1 + HIZ_BLOCK - 1) / HIZ_BLOCK, 0);
+	}
+}
+
+void Framebuffer::prepare(const Rect &r) {
+	auto clipped = r.intersect(Rect(0, 0, width, height));
+	if (clipped.empty()) return;
+	for (auto row = clipped.y0 / tile_size; row <= (clipped.y1 - 1) / tile_size; ++row) {
+		for (auto col = clipped.x0 / tile_size; col <= (clipped.x1 - 1) / tile_size; ++col) {
+			if (pending_clear[col + row * cols]) clear_tile(col + row * cols);
+		}
+	}
+}
+
+void Framebuffer::resolve() {
+	for (auto tile = 0; tile < cols * rows; ++tile) {
+		if (pending_clear[tile]) clear_tile(tile);
+	}
+}
+
+uint32_t *Framebuffer::depth_buffer() {
+	return depth.data();
+}
+
+void Framebuffer::update_hiz(const Rect &r) {
+	auto clipped = r.intersect(Rect(0, 0, width, height));
+	if (clipped.empty()) return;
+	for (auto by = clipped.y0 / HIZ_BLOCK; by <= (clipped.y1 - 1) / HIZ_BLOCK; ++by) {
+		auto y0 = by * HIZ_BLOCK;
+		auto y1 = std::min(y0 + HIZ_BLOCK, height);
+		for (auto bx = clipped.x0 / HIZ_BLOCK; bx <= (clipped.x1 - 1) / HIZ_BLOCK; ++bx) {
+			auto x0 = bx * HIZ_BLOCK;
+			auto x1 = std::min(x0 + HIZ_BLOCK, width);
+			auto farthest = UINT32_MAX;
+			for (auto y = y0; y < y1; ++y) {
+				auto row = depth.data() + static_cast<size_t>(y) * width;
+				for (auto x = x0; x < x1; ++x) {
+					farthest = std::min(farthest, row[x]);
+				}
+			}
+			hiz[bx + by * hiz_cols] = farthest;
+		}
+	}
+}
+
+TGAColor Framebuffer::get(int x, int y) {
+	return color.get(x, y);
+}
+
+TGAImage &Framebuffer::get_image() {
+	return color;
+}
@@ -0,0 +1,99 @@
+#ifndef __FRAMEBUFFER_H__
+#define __FRAMEBUFFER_H__
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "tgaimage.h"
+#include "tiles.h"
+
+// how depth values are stored. both kinds encode a depth in [0, 1] into a uint32_t such that
+// comparing the integers orders the depths the same way, so every depth test is an integer compare
+enum DepthFormat {
+	DEPTH_FLOAT32, // the bits of the float itself (non-negative floats sort like their bits)
+	DEPTH_UNORM24  // depth * (2^24 - 1), rounded. the top byte is left empty
+};
+
+const char *depth_format_name(DepthFormat format);
+// parse "float" or "unorm24", anything else is float
+DepthFormat parse_depth_format(const char *name);
+
+// the scalar depth encoder, the SIMD kernels must agree with it bit for bit
+inline uint32_t encode_depth(float z, DepthFormat format) {
+	// written so that -0 and NaN clamp to 0 the same way SIMD max/min do
+	z = z > 0 ? z : 0;
+	if (format == DEPTH_UNORM24) {
+		z = z < 1 ? z : 1;
+		return static_cast<uint32_t>(z * 16777215.0f + 0.5f);
+	}
+	uint32_t bits;
+	memcpy(&bits, &z, sizeof(bits));
+	return bits;
+}
+
+// hierarchical z keeps one value per HIZ_BLOCK square of pixels
+const int HIZ_BLOCK = 8;
+
+// a color and depth render target, sized at runtime. clearing is lazy: clear() only marks every
+// tile as pending, and a tile is actually filled the first time something is about to draw into
+// it (or when the frame is finished). tiles don't share pixels, so different threads can prepare
+// and draw different tiles at the same time. resizing to the same size (or a new frame) reuses
+// the existing allocations.
+// alongside the depth buffer sits a coarse hierarchical z: the farthest depth in each HIZ_BLOCK
+// square. a triangle that can't get nearer than that can't pass the depth test anywhere in the
+// block, so the block (or the whole triangle) can be skipped without touching the z-buffer.
+// only the farthest depth is kept, since that's all rejection needs.
+// a framebuffer can also hold just a band of rows of a bigger image: everything about it is in
+// its own rows, and the origin only says which image row its row 0 is, for shading
+class Framebuffer {
+private:
+	int width;
+	int height;
+	int origin_y;
+	int tile_size;
+	int cols;
+	int rows;
+	DepthFormat depth_format;
+	TGAImage color;              // RGB, row 0 at the bottom
+	std::vector<uint32_t> depth; // encoded depths, 0 is the far plane
+	std::vector<unsigned char> pending_clear; // per tile
+	TGAColor clear_color;
+	int hiz_cols;
+	int hiz_rows;
+	std::vector<uint32_t> hiz; // farthest (smallest) encoded depth in each block
+
+	void clear_tile(int tile);
+public:
+	// tile has to be a multiple of HIZ_BLOCK, so that no block straddles two tiles
+	Framebuffer(int w, int h, int tile = 64, DepthFormat format = DEPTH_FLOAT32);
+	// change size or depth format, only reallocating when the size actually changes
+	void resize(int w, int h, DepthFormat format);
+	int get_width();
+	int get_height();
+	DepthFormat get_depth_format();
+	// the image row this framebuffer's row 0 is, 0 unless it holds a band
+	int get_origin_y();
+	void set_origin_y(int y);
+	// mark every tile to be cleared to c and the far depth
+	void clear(TGAColor c);
+	// actually clear any pending tiles overlapping r, before drawing into it
+	void prepare(const Rect &r);
+	// clear every still-pending tile, before reading the frame back out
+	void resolve();
+	// row-major, width values per row
+	uint32_t *depth_buffer();
+	inline void set(int x, int y, TGAColor c) {
+		memcpy(color.buffer() + (x + static_cast<size_t>(y) * width) * 3, c.raw, 3);
+	}
+	TGAColor get(int x, int y);
+	// the farthest depth in block (bx, by)
+	inline uint32_t hiz_farthest(int bx, int by) {
+		return hiz[bx + by * hiz_cols];
+	}
+	// recompute the hierarchical z of every block overlapping r, after drawing into it
+	void update_hiz(const Rect &r);
+	// the color buffer, resolve() first
+	TGAImage &get_image();
+};
+
+#endif //__FRAMEBUFFER_H__
@@ -39,10 +39,57 @@ template <class t> struct Vec3 {
   template <class > friend std::ostream& operator<<(std::ostream& s, Vec3<t>& v);
 };
 
+template <class t> struct Vec4 {
+  union {
+    struct {t x, y, z, w;};
+    t raw[4];
+  };
+  Vec4() : x(0), y(0), z(0), w(0) {}
+  Vec4(t _x, t _y, t _z, t _w) : x(_x),y(_y),z(_z),w(_w) {}
+  Vec4(const Vec3<t> &v, t _w) : x(v.x),y(v.y),z(v.z),w(_w) {}
+  inline Vec4<t> operator +(const Vec4<t> &v) const { return Vec4<t>(x+v.x, y+v.y, z+v.z, w+v.w); }
+  inline Vec4<t> operator -(const Vec4<t> &v) const { return Vec4<t>(x-v.x, y-v.y, z-v.z, w-v.w); }
+  inline Vec4<t> operator *(float f)          const { return Vec4<t>(x*f, y*f, z*f, w*f); }
+  inline t       operator *(const Vec4<t> &v) const { return x*v.x + y*v.y + z*v.z + w*v.w; }
+  inline Vec3<t> xyz() const { return Vec3<t>(x, y, z); }
+  // back from homogeneous coordinates
+  inline Vec3<t> project() const { return Vec3<t>(x/w, y/w, z/w); }
+  template <class > friend std::ostream& operator<<(std::ostream& s, Vec4<t>& v);
+};
+
 typedef Vec2<float> Vec2f;
 typedef Vec2<int>   Vec2i;
 typedef Vec3<float> Vec3f;
 typedef Vec3<int>   Vec3i;
+typedef Vec4<float> Vec4f;
+
+// a 4x4 matrix, stored a row at a time. it multiplies column vectors on its right, so
+// (a * b) * v applies b first
+struct Mat4f {
+  float m[4][4];
+  Mat4f() { for (int i=0; i<4; i++) for (int j=0; j<4; j++) m[i][j] = i == j ? 1.f : 0.f; }
+  inline float *operator [](int i) { return m[i]; }
+  inline const float *operator [](int i) const { return m[i]; }
+  inline Mat4f operator *(const Mat4f &b) const {
+    Mat4f r;
+    for (int i=0; i<4; i++) for (int j=0; j<4; j++) r.m[i][j] = m[i][0]*b.m[0][j] + m[i][1]*b.m[1][j] + m[i][2]*b.m[2][j] + m[i][3]*b.m[3][j];
+    return r;
+  }
+  // every kernel that transforms points sums in this order, so they all round the same
+  inline Vec4f operator *(const Vec4f &v) const {
+    return Vec4f(
+      m[0][0]*v.x + m[0][1]*v.y + m[0][2]*v.z + m[0][3]*v.w,
+      m[1][0]*v.x + m[1][1]*v.y + m[1][2]*v.z + m[1][3]*v.w,
+      m[2][0]*v.x + m[2][1]*v.y + m[2][2]*v.z + m[2][3]*v.w,
+      m[3][0]*v.x + m[3][1]*v.y + m[3][2]*v.z + m[3][3]*v.w
+    );
+  }
+  inline Mat4f transpose() const {
+    Mat4f r;
+    for (int i=0; i<4; i++) for (int j=0; j<4; j++) r.m[i][j] = m[j][i];
+    return r;
+  }
+};
 
 template <class t> std::ostream& operator<<(std::ostream& s, Vec2<t>& v) {
   s << "(" << v.x << ", " << v.y << ")\n";
@@ -54,4 +101,9 @@ template <class t> std::ostream& operator<<(std::ostream& s, Vec3<t>& v) {
   return s;
 }
 
+template <class t> std::ostream& operator<<(std::ostream& s, Vec4<t>& v) {
+  s << "(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")\n";
+  return s;
+}
+
 #endif //__GEOMETRY_H__
@@ -0,0 +1,55 @@
+#ifndef __HIZ_H__
+#define __HIZ_H__
+
+#include <algorithm>
+#include "framebuffer.h"
+#include "raster_simd.h"
+#include "stats.h"
+
+// rasterize_depth_tested into fb, but skip every HIZ_BLOCK square the triangle can't win: if its
+// nearest vertex isn't nearer than the farthest depth already in a block, no pixel of it will pass
+// the z test there. surviving blocks are drawn a row of blocks at a time, in runs, and their
+// hierarchical z is brought up to date afterwards. the image is exactly what
+// rasterize_depth_tested alone would draw
+template <class F>
+void rasterize_hiz(RasterIsa isa, const TriangleSetup &t, const Rect &clip, Vec3f z, Framebuffer &fb, RenderStats &stats, F shade) {
+	auto r = t.bounds.intersect(clip);
+	if (r.empty()) return;
+	stats.triangles_rasterized++;
+
+	// the nearest the triangle gets. interpolated depths can come out a few ulps past the
+	// vertices' after rounding, so leave a little room
+	auto nearest_z = std::max(z.x, std::max(z.y, z.z));
+	auto nearest = encode_depth(nearest_z + std::abs(nearest_z) * (1.0f / 65536), fb.get_depth_format());
+
+	auto drew = false;
+	auto all_culled = true;
+	auto bx0 = r.x0 / HIZ_BLOCK;
+	auto bx1 = (r.x1 - 1) / HIZ_BLOCK + 1;
+	for (auto by = r.y0 / HIZ_BLOCK; by <= (r.y1 - 1) / HIZ_BLOCK; ++by) {
+		auto run = -1; // first block of the current run of visible blocks
+		for (auto bx = bx0; bx <= bx1; ++bx) {
+			auto visible = false;
+			if (bx < bx1) {
+				visible = fb.hiz_farthest(bx, by) < nearest;
+				stats.blocks_tested++;
+				if (!visible) stats.blocks_hiz_culled++;
+			}
+			if (visible && run < 0) run = bx;
+			if (!visible && run >= 0) {
+				auto span = r.intersect(Rect(run * HIZ_BLOCK, by * HIZ_BLOCK, bx * HIZ_BLOCK, (by + 1) * HIZ_BLOCK));
+				rasterize_depth_tested(isa, t, span, z, fb.depth_buffer(), fb.get_width(), fb.get_depth_format(), stats.pixels_tested, [&](int x, int y, Vec3f weights) {
+					drew = true;
+					shade(x, y, weights);
+				});
+				if (drew) fb.update_hiz(span);
+				drew = false;
+				all_culled = false;
+				run = -1;
+			}
+		}
+	}
+	if (all_culled) stats.triangles_hiz_culled++;
+}
+
+#endif //__HIZ_H__
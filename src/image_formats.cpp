@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "image_formats.h"
+#include "tga_rle.h"
+#include "yuv.h"
+
+const char *image_format_name(ImageFormat format) {
+	switch (format) {
+		case IMAGE_QOI: return "qoi";
+		case IMAGE_PPM: return "ppm";
+		case IMAGE_PAM: return "pam";
+		case IMAGE_Y4M: return "y4m";
+		default: return "tga";
+	}
+}
+
+ImageFormat parse_image_format(const char *name) {
+	if (!strcmp(name, "qoi")) return IMAGE_QOI;
+	if (!strcmp(name, "ppm")) return IMAGE_PPM;
+	if (!strcmp(name, "pam")) return IMAGE_PAM;
+	if (!strcmp(name, "y4m")) return IMAGE_Y4M;
+	return IMAGE_TGA;
+}
+
+ImageFormat image_format_for_path(const std::string &path) {
+	auto dot = path.find_last_of("./");
+	if (dot == std::string::npos || path[dot] != '.') return IMAGE_TGA;
+	auto ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	if (ext == "qoi") return IMAGE_QOI;
+	if (ext == "ppm" || ext == "pgm" || ext == "pnm") return IMAGE_PPM;
+	if (ext == "pam") return IMAGE_PAM;
+	if (ext == "y4m") return IMAGE_Y4M;
+	return IMAGE_TGA;
+}
+
+// qoi chunk tags
+static const unsigned char QOI_OP_INDEX = 0x00;
+static const unsigned char QOI_OP_DIFF = 0x40;
+static const unsigned char QOI_OP_LUMA = 0x80;
+static const unsigned char QOI_OP_RUN = 0xc0;
+static const unsigned char QOI_OP_RGB = 0xfe;
+static const unsigned char QOI_OP_RGBA = 0xff;
+// the longest run one chunk holds
+static const int QOI_MAX_RUN = 62;
+
+// what a pnm of bytespp byte pixels holds per pixel
+static int pnm_channels(int bytespp, bool pam) {
+	return bytespp == 1 ? 1 : bytespp == 4 && pam ? 4 : 3;
+}
+
+static inline unsigned char *put_u32_be(unsigned char *out, uint32_t v) {
+	out[0] = static_cast<unsigned char>(v >> 24);
+	out[1] = static_cast<unsigned char>(v >> 16);
+	out[2] = static_cast<unsigned char>(v >> 8);
+	out[3] = static_cast<unsigned char>(v);
+	return out + 4;
+}
+
+// the chunks for rows of pixels, written from out on. each pixel is packed into one integer
+// (r, g, b, a from the low byte up) so comparing against the previous pixel and the index of
+// recently seen ones is a single compare. a run still going at the end is left in state
+template <int BPP>
+static unsigned char *qoi_encode_pixels(const unsigned char *pixels, int width, int height, bool bottom_up, QoiState &state, unsigned char *out) {
+	uint32_t *index = state.index;
+	int pr = state.prev & 0xff, pg = state.prev >> 8 & 0xff, pb = state.prev >> 16 & 0xff, pa = state.prev >> 24;
+	uint32_t prev = state.prev;
+	auto run = state.run;
+	auto row_bytes = static_cast<size_t>(width) * BPP;
+	for (auto y = 0; y < height; ++y) {
+		auto row = pixels + (bottom_up ? height - 1 - y : y) * row_bytes;
+		for (auto x = 0; x < width; ++x) {
+			auto p = row + x * BPP;
+			int r, g, b, a = 255;
+			if (BPP == 1) {
+				r = g = b = p[0];
+			} else {
+				b = p[0];
+				g = p[1];
+				r = p[2];
+				if (BPP == 4) a = p[3];
+			}
+			auto px = static_cast<uint32_t>(r) | static_cast<uint32_t>(g) << 8 | static_cast<uint32_t>(b) << 16 | static_cast<uint32_t>(a) << 24;
+
+			if (px == prev) {
+				if (++run == QOI_MAX_RUN) {
+					*out++ = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run) {
+				*out++ = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+				run = 0;
+			}
+
+			auto hash = (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+			if (index[hash] == px) {
+				*out++ = static_cast<unsigned char>(QOI_OP_INDEX | hash);
+			} else {
+				index[hash] = px;
+				if (a == pa) {
+					// differences wrap around, as bytes
+					auto dr = static_cast<signed char>(r - pr);
+					auto dg = static_cast<signed char>(g - pg);
+					auto db = static_cast<signed char>(b - pb);
+					auto dr_dg = dr - dg;
+					auto db_dg = db - dg;
+					if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+						*out++ = static_cast<unsigned char>(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+					} else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+						*out++ = static_cast<unsigned char>(QOI_OP_LUMA | (dg + 32));
+						*out++ = static_cast<unsigned char>((dr_dg + 8) << 4 | (db_dg + 8));
+					} else {
+						*out++ = QOI_OP_RGB;
+						*out++ = static_cast<unsigned char>(r);
+						*out++ = static_cast<unsigned char>(g);
+						*out++ = static_cast<unsigned char>(b);
+					}
+				} else {
+					*out++ = QOI_OP_RGBA;
+					*out++ = static_cast<unsigned char>(r);
+					*out++ = static_cast<unsigned char>(g);
+					*out++ = static_cast<unsigned char>(b);
+					*out++ = static_cast<unsigned char>(a);
+				}
+			}
+			prev = px;
+			pr = r;
+			pg = g;
+			pb = b;
+			pa = a;
+		}
+	}
+	state.prev = prev;
+	state.run = run;
+	return out;
+}
+
+QoiState::QoiState() : prev(0xff000000u), run(0) {
+	memset(index, 0, sizeof(index));
+}
+
+static const unsigned char QOI_END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+void qoi_encode_header(int width, int height, int bytespp, std::vector<unsigned char> &out) {
+	unsigned char header[14];
+	memcpy(header, "qoif", 4);
+	put_u32_be(header + 4, width);
+	put_u32_be(header + 8, height);
+	header[12] = static_cast<unsigned char>(bytespp == 4 ? 4 : 3);
+	header[13] = 0; // srgb with linear alpha
+	out.insert(out.end(), header, header + sizeof(header));
+}
+
+void qoi_encode_rows(const unsigned char *pixels, int width, int rows, int bytespp, bool bottom_up, QoiState &state, std::vector<unsigned char> &out) {
+	// at worst a tag and every channel for each pixel, after the run the rows before left going
+	auto start = out.size();
+	out.resize(start + static_cast<size_t>(width) * rows * ((bytespp == 4 ? 4 : 3) + 1) + 1);
+	auto p = out.data() + start;
+	switch (bytespp) {
+		case 1: p = qoi_encode_pixels<1>(pixels, width, rows, bottom_up, state, p); break;
+		case 4: p = qoi_encode_pixels<4>(pixels, width, rows, bottom_up, state, p); break;
+		default: p = qoi_encode_pixels<3>(pixels, width, rows, bottom_up, state, p); break;
+	}
+	out.resize(p - out.data());
+}
+
+void qoi_encode_end(QoiState &state, std::vector<unsigned char> &out) {
+	if (state.run) out.push_back(static_cast<unsigned char>(QOI_OP_RUN | (state.run - 1)));
+	state.run = 0;
+	out.insert(out.end(), QOI_END_MARKER, QOI_END_MARKER + sizeof(QOI_END_MARKER));
+}
+
+void qoi_encode(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, std::vector<unsigned char> &out) {
+	QoiState state;
+	out.reserve(out.size() + 14 + static_cast<size_t>(width) * height * ((bytespp == 4 ? 4 : 3) + 1) + sizeof(QOI_END_MARKER));
+	qoi_encode_header(width, height, bytespp, out);
+	qoi_encode_rows(pixels, width, height, bytespp, bottom_up, state, out);
+	qoi_encode_end(state, out);
+}
+
+void pnm_encode_header(int width, int height, int bytespp, bool pam, std::vector<unsigned char> &out) {
+	auto channels = pnm_channels(bytespp, pam);
+	char header[128];
+	int n;
+	if (pam) {
+		auto tupltype = channels == 1 ? "GRAYSCALE" : channels == 4 ? "RGB_ALPHA" : "RGB";
+		n = snprintf(header, sizeof(header), "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n", width, height, channels, tupltype);
+	} else {
+		n = snprintf(header, sizeof(header), "P%d\n%d %d\n255\n", channels == 1 ? 5 : 6, width, height);
+	}
+	out.insert(out.end(), header, header + n);
+}
+
+void pnm_encode_rows(const unsigned char *pixels, int width, int rows, int bytespp, bool bottom_up, bool pam, std::vector<unsigned char> &out) {
+	auto channels = pnm_channels(bytespp, pam);
+	auto row_out = static_cast<size_t>(width) * channels;
+	auto start = out.size();
+	out.resize(start + row_out * rows);
+
+	// rows top first, bgr(a) swapped to rgb(a)
+	auto dst = out.data() + start;
+	auto row_bytes = static_cast<size_t>(width) * bytespp;
+	for (auto y = 0; y < rows; ++y, dst += row_out) {
+		auto src = pixels + (bottom_up ? rows - 1 - y : y) * row_bytes;
+		if (bytespp == 1) {
+			memcpy(dst, src, row_out);
+			continue;
+		}
+		auto d = dst;
+		for (auto x = 0; x < width; ++x, src += bytespp, d += channels) {
+			d[0] = src[2];
+			d[1] = src[1];
+			d[2] = src[0];
+			if (channels == 4) d[3] = src[3];
+		}
+	}
+}
+
+void pnm_encode(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, bool pam, std::vector<unsigned char> &out) {
+	pnm_encode_header(width, height, bytespp, pam, out);
+	pnm_encode_rows(pixels, width, height, bytespp, bottom_up, pam, out);
+}
+
+void y4m_encode_header(int width, int height, int fps, std::vector<unsigned char> &out) {
+	// chroma sited between the pixels it averages, and video rather than full range levels
+	char header[128];
+	auto n = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, fps);
+	out.insert(out.end(), header, header + n);
+}
+
+void y4m_encode_frame(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, std::vector<unsigned char> &out) {
+	static const auto isa = detect_raster_isa();
+	static const char FRAME[] = "FRAME\n";
+	auto cw = (width + 1) / 2;
+	auto ch = (height + 1) / 2;
+	auto luma_size = static_cast<size_t>(width) * height;
+	auto chroma_size = static_cast<size_t>(cw) * ch;
+	auto start = out.size();
+	out.resize(start + sizeof(FRAME) - 1 + luma_size + 2 * chroma_size);
+	memcpy(out.data() + start, FRAME, sizeof(FRAME) - 1);
+	auto y_plane = out.data() + start + sizeof(FRAME) - 1;
+	auto cb_plane = y_plane + luma_size;
+	auto cr_plane = cb_plane + chroma_size;
+
+	// the converter takes bgr, anything else goes through a pair of rows widened to it
+	auto row_bytes = static_cast<size_t>(width) * bytespp;
+	std::vector<unsigned char> bgr(bytespp == 3 ? 0 : 6 * static_cast<size_t>(width));
+	auto row = [&](int y, int slot) {
+		auto src = pixels + (bottom_up ? height - 1 - y : y) * row_bytes;
+		if (bytespp == 3) return src;
+		auto dst = bgr.data() + slot * 3 * static_cast<size_t>(width);
+		for (auto x = 0; x < width; ++x, src += bytespp) {
+			dst[3 * x] = src[0];
+			dst[3 * x + 1] = bytespp == 1 ? src[0] : src[1];
+			dst[3 * x + 2] = bytespp == 1 ? src[0] : src[2];
+		}
+		return static_cast<const unsigned char *>(dst);
+	};
+	for (auto y = 0; y < height; y += 2) {
+		// an odd height's last row pairs with itself, and writes its luma twice
+		auto y1 = y + 1 < height ? y + 1 : y;
+		auto top = row(y, 0);
+		auto bottom = y1 == y ? top : row(y1, 1);
+		bgr_to_yuv420(isa, top, bottom, width, y_plane + static_cast<size_t>(y) * width, y_plane + static_cast<size_t>(y1) * width,
+			cb_plane + static_cast<size_t>(y / 2) * cw, cr_plane + static_cast<size_t>(y / 2) * cw);
+	}
+}
+
+bool write_image(const char *filename, ImageFormat format, TGAImage &image, bool bottom_up, ThreadPool *pool) {
+	std::vector<unsigned char> file;
+	return encode_image(format, image, file, bottom_up, pool) && write_file(filename, file);
+}
+
+bool encode_image(ImageFormat format, TGAImage &image, std::vector<unsigned char> &file, bool bottom_up, ThreadPool *pool) {
+	switch (format) {
+		case IMAGE_QOI:
+			qoi_encode(image.buffer(), image.get_width(), image.get_height(), image.get_bytespp(), bottom_up, file);
+			break;
+		case IMAGE_PPM:
+		case IMAGE_PAM:
+			pnm_encode(image.buffer(), image.get_width(), image.get_height(), image.get_bytespp(), bottom_up, format == IMAGE_PAM, file);
+			break;
+		case IMAGE_Y4M:
+			y4m_encode_header(image.get_width(), image.get_height(), 30, file);
+			y4m_encode_frame(image.buffer(), image.get_width(), image.get_height(), image.get_bytespp(), bottom_up, file);
+			break;
+		default:
+			return image.encode_tga(file, true, pool, bottom_up);
+	}
+	return true;
+}
+
+bool write_file(const char *filename, const std::vector<unsigned char> &file) {
+	if (!strcmp(filename, "-")) {
+		std::cout.write(reinterpret_cast<const char *>(file.data()), file.size());
+		return bool(std::cout.flush());
+	}
+	std::ofstream out(filename, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+	out.write(reinterpret_cast<const char *>(file.data()), file.size());
+	if (!out.good()) {
+		std::cerr << "can't write file " << filename << "\n";
+		return false;
+	}
+	return true;
+}
+
+ImageStream::ImageStream() : format(IMAGE_TGA), width(0), height(0), bytespp(0), rows_written(0), pool(nullptr), out(nullptr) {
+}
+
+bool ImageStream::open(const char *filename, ImageFormat f, int w, int h, int bpp, ThreadPool *p) {
+	format = f;
+	width = w;
+	height = h;
+	bytespp = bpp;
+	rows_written = 0;
+	pool = p;
+	qoi = QoiState();
+	name = filename;
+	out = nullptr;
+	if (format == IMAGE_Y4M) {
+		std::cerr << "y4m can't be written a band at a time\n";
+		return false;
+	}
+	if (format == IMAGE_TGA && (width > 0xffff || height > 0xffff)) {
+		std::cerr << "a tga can't be " << width << "x" << height << ", 65535 pixels a side at the most\n";
+		return false;
+	}
+	if (name == "-") {
+		out = &std::cout;
+	} else {
+		file.open(filename, std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "can't open file " << filename << "\n";
+			return false;
+		}
+		out = &file;
+	}
+
+	buffer.clear();
+	switch (format) {
+		case IMAGE_QOI: qoi_encode_header(width, height, bytespp, buffer); break;
+		case IMAGE_PPM:
+		case IMAGE_PAM: pnm_encode_header(width, height, bytespp, format == IMAGE_PAM, buffer); break;
+		default: tga_encode_header(width, height, bytespp, true, true, buffer); break;
+	}
+	return flush();
+}
+
+bool ImageStream::rows_bottom_up() const {
+	return format == IMAGE_TGA;
+}
+
+bool ImageStream::flush() {
+	out->write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	buffer.clear();
+	if (!out->good()) {
+		std::cerr << "can't write file " << name << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool ImageStream::write_rows(const unsigned char *pixels, int rows, bool bottom_up) {
+	if (!out) return false;
+	rows_written += rows;
+	switch (format) {
+		case IMAGE_QOI:
+			qoi_encode_rows(pixels, width, rows, bytespp, bottom_up, qoi, buffer);
+			break;
+		case IMAGE_PPM:
+		case IMAGE_PAM:
+			pnm_encode_rows(pixels, width, rows, bytespp, bottom_up, format == IMAGE_PAM, buffer);
+			break;
+		default:
+			if (bottom_up) {
+				rle_encode(pixels, width, rows, bytespp, buffer, pool);
+			} else {
+				// the file wants the block's last row first. packets never cross rows, so a row at a time
+				auto row_bytes = static_cast<size_t>(width) * bytespp;
+				for (auto y = rows - 1; y >= 0; --y) rle_encode(pixels + y * row_bytes, width, 1, bytespp, buffer);
+			}
+			break;
+	}
+	return flush();
+}
+
+bool ImageStream::close() {
+	if (!out) return false;
+	switch (format) {
+		case IMAGE_QOI: qoi_encode_end(qoi, buffer); break;
+		case IMAGE_PPM:
+		case IMAGE_PAM: break;
+		default: tga_encode_footer(buffer); break;
+	}
+	auto ok = flush();
+	if (out == &file) {
+		file.close();
+		ok = ok && !file.fail();
+	} else {
+		ok = ok && bool(out->flush());
+	}
+	out = nullptr;
+	if (ok && rows_written != height) {
+		std::cerr << name << " got " << rows_written << " of its " << height << " rows\n";
+		ok = false;
+	}
+	return ok;
+}
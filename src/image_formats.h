@@ -0,0 +1,99 @@
+#ifndef __IMAGE_FORMATS_H__
+#define __IMAGE_FORMATS_H__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "tgaimage.h"
+
+class ThreadPool;
+
+// what an image can be written out as
+enum ImageFormat {
+	IMAGE_TGA, // run-length encoded tga
+	IMAGE_QOI, // "quite ok image" format: lossless, one pass, far smaller than tga rle on renders
+	IMAGE_PPM, // binary ppm (pgm for grayscale), uncompressed. for piping into other tools
+	IMAGE_PAM, // the same, with alpha kept
+	IMAGE_Y4M  // yuv4mpeg2, 4:2:0 frames one after another, what video encoders read from a pipe
+};
+
+const char *image_format_name(ImageFormat format);
+// parse "tga", "qoi", "ppm", "pam" or "y4m", anything else is tga
+ImageFormat parse_image_format(const char *name);
+// the format a file name's extension asks for: .qoi, .ppm/.pgm/.pnm, .pam, .y4m, and tga otherwise
+ImageFormat image_format_for_path(const std::string &path);
+
+// the whole qoi file for width x height bgr(a) or grayscale pixels, appended to out. grayscale
+// comes out as rgb, since qoi has nothing smaller. bottom_up pixels (row 0 at the bottom) are
+// read from the last row up, qoi files always start at the top
+void qoi_encode(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, std::vector<unsigned char> &out);
+
+// the same a piece at a time: the header, then rows in as many calls as it takes (each block of
+// rows bottom_up or not on its own), then the end. state carries what the rows so far left behind
+struct QoiState {
+	uint32_t index[64]; // recently seen pixels, packed r g b a from the low byte
+	uint32_t prev;
+	int run;            // pixels equal to prev not written out yet
+	QoiState();
+};
+void qoi_encode_header(int width, int height, int bytespp, std::vector<unsigned char> &out);
+void qoi_encode_rows(const unsigned char *pixels, int width, int rows, int bytespp, bool bottom_up, QoiState &state, std::vector<unsigned char> &out);
+void qoi_encode_end(QoiState &state, std::vector<unsigned char> &out);
+
+// the whole binary netpbm file, appended to out. pam keeps an alpha channel, ppm drops it.
+// grayscale is a pgm either way (or a pam of depth 1). bottom_up as for qoi_encode
+void pnm_encode(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, bool pam, std::vector<unsigned char> &out);
+// and a piece at a time
+void pnm_encode_header(int width, int height, int bytespp, bool pam, std::vector<unsigned char> &out);
+void pnm_encode_rows(const unsigned char *pixels, int width, int rows, int bytespp, bool bottom_up, bool pam, std::vector<unsigned char> &out);
+
+// the y4m stream header, for width x height frames at fps a second
+void y4m_encode_header(int width, int height, int fps, std::vector<unsigned char> &out);
+// one frame of width x height bgr(a) or grayscale pixels, appended to out: its marker, then the
+// luma plane and the two chroma planes, converted straight into out. bottom_up as for qoi_encode
+void y4m_encode_frame(const unsigned char *pixels, int width, int height, int bytespp, bool bottom_up, std::vector<unsigned char> &out);
+
+// encode image as format (tga rle bands on pool, if given) and write it to filename in one go,
+// or to stdout for "-"
+// (a y4m of one frame, at 30 a second)
+bool write_image(const char *filename, ImageFormat format, TGAImage &image, bool bottom_up = false, ThreadPool *pool = nullptr);
+// write_image's two halves: the whole file, appended to out (false if the image is too big for
+// a tga), and writing that to filename or stdout (false, and a message, if it can't be)
+bool encode_image(ImageFormat format, TGAImage &image, std::vector<unsigned char> &out, bool bottom_up = false, ThreadPool *pool = nullptr);
+bool write_file(const char *filename, const std::vector<unsigned char> &file);
+
+// an image written to a file (or stdout, for "-") a block of rows at a time, so the whole of it
+// never has to be in memory. tga goes bottom row first, which its header can say, everything
+// else top row first: rows have to come in the order rows_bottom_up() gives. nothing is
+// buffered beyond the block being written. not for y4m, whose chroma spans pairs of rows
+class ImageStream {
+private:
+	ImageFormat format;
+	int width;
+	int height;
+	int bytespp;
+	int rows_written;
+	ThreadPool *pool;
+	QoiState qoi;
+	std::ofstream file;
+	std::ostream *out;
+	std::string name;
+	std::vector<unsigned char> buffer; // one block's encoding, reused
+
+	bool flush();
+public:
+	ImageStream();
+	// start a width x height image of bytespp byte pixels. tga rle bands are encoded on pool, if
+	// given. false (and a message) if the file can't be opened or the format can't be that big
+	bool open(const char *filename, ImageFormat format, int width, int height, int bytespp, ThreadPool *pool = nullptr);
+	// whether the file's rows go from the bottom of the image up
+	bool rows_bottom_up() const;
+	// the next rows of the image, in the file's order. pixels is a block of them, row 0 at the
+	// bottom if bottom_up, like a framebuffer, or at the top
+	bool write_rows(const unsigned char *pixels, int rows, bool bottom_up);
+	// finish the file. false if any of it couldn't be written, or rows are missing
+	bool close();
+};
+
+#endif //__IMAGE_FORMATS_H__
@@ -0,0 +1,107 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "instrument.h"
+
+const char *stage_name(Stage stage) {
+	switch (stage) {
+		case STAGE_LOAD: return "load";
+		case STAGE_TEXTURE: return "texture";
+		case STAGE_VERTEX: return "vertex";
+		case STAGE_ASSEMBLE: return "assemble";
+		case STAGE_RASTER: return "raster";
+		case STAGE_SHADE: return "shade";
+		case STAGE_ENCODE: return "encode";
+		case STAGE_WRITE: return "write";
+		default: return "?";
+	}
+}
+
+#if RENDERER_INSTRUMENT
+
+// every allocation carries its size in front of it, in a header as big as malloc's alignment so
+// what's handed out stays just as aligned
+static const size_t HEADER = alignof(std::max_align_t);
+
+static std::atomic<size_t> heap_current(0);
+static std::atomic<size_t> heap_high(0);
+
+static void *tracked_alloc(size_t size) {
+	auto block = static_cast<char *>(std::malloc(size + HEADER));
+	if (!block) return nullptr;
+	*reinterpret_cast<size_t *>(block) = size;
+	auto now = heap_current.fetch_add(size, std::memory_order_relaxed) + size;
+	auto high = heap_high.load(std::memory_order_relaxed);
+	while (now > high && !heap_high.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+	}
+	return block + HEADER;
+}
+
+static void tracked_free(void *p) {
+	if (!p) return;
+	auto block = static_cast<char *>(p) - HEADER;
+	heap_current.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+void *operator new(size_t size) {
+	auto p = tracked_alloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return tracked_alloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return tracked_alloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept {
+	tracked_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	tracked_free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	tracked_free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	tracked_free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+	tracked_free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	tracked_free(p);
+}
+
+size_t heap_allocated() {
+	return heap_current.load(std::memory_order_relaxed);
+}
+
+size_t heap_peak() {
+	return heap_high.load(std::memory_order_relaxed);
+}
+
+#else
+
+size_t heap_allocated() {
+	return 0;
+}
+
+size_t heap_peak() {
+	return 0;
+}
+
+#endif //RENDERER_INSTRUMENT
@@ -0,0 +1,75 @@
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <chrono>
+#include <cstddef>
+#include "RendererConfig.h"
+
+// stage timers, the per-pixel counters and heap tracking are built in unless cmake is run with
+// -DRENDERER_INSTRUMENT=OFF. everything that costs anything checks this, so turned off it all
+// folds away and reads as zero
+const bool INSTRUMENTED = RENDERER_INSTRUMENT != 0;
+
+// where a frame's time goes, in the order it goes there
+enum Stage {
+	STAGE_LOAD,     // reading the model
+	STAGE_TEXTURE,  // reading the texture and converting it for sampling
+	STAGE_VERTEX,   // transforming vertices to the screen
+	STAGE_ASSEMBLE, // culling, clipping and setting up triangles
+	STAGE_RASTER,   // coverage and depth testing (and shading too, unless deferred)
+	STAGE_SHADE,    // the deferred shading pass
+	STAGE_ENCODE,   // getting the framebuffer into an image, and that into a file's bytes
+	STAGE_WRITE,    // writing it
+	STAGE_COUNT
+};
+
+const char *stage_name(Stage stage);
+
+// wall clock seconds spent in each stage
+struct StageTimes {
+	double seconds[STAGE_COUNT];
+
+	StageTimes() {
+		for (auto &s : seconds) s = 0;
+	}
+
+	void add(const StageTimes &t) {
+		for (auto i = 0; i < STAGE_COUNT; ++i) seconds[i] += t.seconds[i];
+	}
+
+	double total() const {
+		double sum = 0;
+		for (auto s : seconds) sum += s;
+		return sum;
+	}
+};
+
+// adds the time from its construction to its destruction (or stop(), if that comes first) to
+// times.seconds[stage]
+class StageTimer {
+private:
+	StageTimes &times;
+	Stage stage;
+	bool running;
+	std::chrono::steady_clock::time_point start;
+public:
+	StageTimer(StageTimes &t, Stage s) : times(t), stage(s), running(true) {
+		if (INSTRUMENTED) start = std::chrono::steady_clock::now();
+	}
+	~StageTimer() {
+		stop();
+	}
+	void stop() {
+		if (INSTRUMENTED && running) times.seconds[stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		running = false;
+	}
+	StageTimer(const StageTimer &) = delete;
+	StageTimer &operator=(const StageTimer &) = delete;
+};
+
+// bytes allocated through operator new and not yet freed, and the most there have been at once.
+// memory mapped files don't count. both are 0 when not instrumented
+size_t heap_allocated();
+size_t heap_peak();
+
+#endif //__INSTRUMENT_H__
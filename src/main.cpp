@@ -9,192 +9,342 @@
 #include "tgaimage.h"
 #include "model.h"
 #include "util.h"
-#include <array>
+#include "raster_simd.h"
+#include "obj_loader.h"
+#include "mesh_cache.h"
+#include "thread_pool.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "banded.h"
+#include "batch.h"
+#include "server.h"
+#include "shard.h"
+#include "output_queue.h"
+#include "frame_stream.h"
+#include "stats.h"
+#include "texture.h"
+#include "camera.h"
+#include "pipeline.h"
+#include "report.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <map>
+#include <sstream>
+#include <string>
+#include <vector>
 
-const auto WIDTH = 2048;
-const auto HEIGHT = 2048;
-const auto AREA = WIDTH * HEIGHT;
-
-// convert from world coordinates to screen coordinates
-// add 1 to each point to make all numbers positive, then scale by dimension
-Vec3f convert_to_screen_coordinates(Vec3f point) {
-	auto c = 4; // camera's distance from the origin in the positive z direction
-
-	// project onto the plane z=1
-	auto x = point.x / (1 - point.z / c);
-	auto y = point.y / (1 - point.z / c);
-	auto z = point.z / (1 - point.z / c);
-
-	auto scale = std::sqrt(AREA);
-	return Vec3f(
-		float((x + 1.0) * scale / 2),
-		float((y + 1.0) * scale / 2),
-		float((z + 1.0) * scale / 2)
-	);
-}
-
-// calculate the RGBA illumination for normal n, according to directional light
-// BUG?: this operation ignores occlusion by other faces!
-TGAColor get_illumination(Vec3f &normal, Vec3f &light_source) {
-
-	auto n = normal.normalize();
-	auto l = light_source.normalize();
+const auto DEFAULT_WIDTH = 2048;
+const auto DEFAULT_HEIGHT = 2048;
 
-	// now find the angle between the directional light and the normal (theta from here forwards)
-	auto cos_theta = dot_product(n, l) / n.norm() * l.norm();
-
-	// cos_theta will be between -1.0 and 1.0
-	auto brightness = static_cast<unsigned char>(std::round(200 * ((1 + cos_theta) / 2)));
-	return TGAColor(brightness, brightness, brightness, 255);
-}
-
-// rasterize the triangle described by vertices a b c onto the passed TGAImage
-void draw_face(Face &face, TGAImage &image, std::unique_ptr<std::array<double, AREA>> &zbuffer, TGAImage &texture, Vec3f &light_source) {
-
-	// (a, b, c) describes the position of the face's vertices
-	auto a = convert_to_screen_coordinates(face.get_vertices()[0].get_position());
-	auto b = convert_to_screen_coordinates(face.get_vertices()[1].get_position());
-	auto c = convert_to_screen_coordinates(face.get_vertices()[2].get_position());
-
-	// (at, bt, ct) describes the (u, v) position of each vertex's corresponding texel
-	auto at = face.get_vertices()[0].get_texture_coordinates();
-	auto bt = face.get_vertices()[1].get_texture_coordinates();
-	auto ct = face.get_vertices()[2].get_texture_coordinates();
-
-	// (an, bn, cn) describes the vertices normal's (if provided)
-	// we don't both calculating our own
-	auto an = face.get_vertices()[0].get_normal();
-	auto bn = face.get_vertices()[1].get_normal();
-	auto cn = face.get_vertices()[2].get_normal();
-
-	// of the triangle's corner vertices, find the maxes and mins of x and y.
-	// those describe the bounding box
-	std::vector<float> x_extrema = {a.x, b.x, c.x};
-	std::vector<float> y_extrema = {a.y, b.y, c.y};
-
-	// this is where we go from floating point to integral,
-	// we find the integral bounding box that wraps the floating point vertices
-	auto x_max = static_cast<int>(std::round(*max_element(x_extrema.begin(), x_extrema.end())));
-	auto x_min = static_cast<int>(std::round(*min_element(x_extrema.begin(), x_extrema.end())));
-	auto y_max = static_cast<int>(std::round(*max_element(y_extrema.begin(), y_extrema.end())));
-	auto y_min = static_cast<int>(std::round(*min_element(y_extrema.begin(), y_extrema.end())));
-
-	// iterate over each point in the bounding box
-	for (auto x = x_min; x < x_max + 1; ++x) {
-		// bounds check
-		if (x < 0 || x >= WIDTH) continue;
-		for (auto y = y_min; y < y_max + 1; ++y) {
-			// bounds check
-			if (y < 0 || y >= HEIGHT) continue;
-			Vec2i point(x, y);
-			// find the barycentric weight point P within the triangle
-			Vec3f barycentric_weights = barycentric(point, a, b, c);
-			// if any of those barycentric weights is less 0, then the point isn't in the triangle
-			if (!(barycentric_weights.x < 0 || barycentric_weights.y < 0 || barycentric_weights.z < 0)) {
-				// draw the point if it's in the triangle & is of the lowest z value we've encountered
-				// (lazily) get the cartesian z coordinate for point (x, y) from the barycentric weights we calculated
-				double z = 0;
-				z += a.z * barycentric_weights.x; // u
-				z += b.z * barycentric_weights.y; // v
-				z += c.z * barycentric_weights.z; // w
-
-				// we need to find a, the point in (at, bt, ct) that corresponds with (a, b, c)
-				// we have: a, b, c, point p, at.uv, bt.uv, ct.uv
-
-				// the point p is now encoded as three barycentric weights
-				// use our point p to find the correct part the texture
-				double x_t = 0;
-				x_t += at.x * barycentric_weights.x;
-				x_t += bt.x * barycentric_weights.y;
-				x_t += ct.x * barycentric_weights.z;
-				double y_t = 0;
-				y_t += at.y * barycentric_weights.x;
-				y_t += bt.y * barycentric_weights.y;
-				y_t += ct.y * barycentric_weights.z;
-
-				// check in with our z buffer
-				if ((*zbuffer)[x + y * WIDTH] < z) {
-					// add our new highest z value
-					(*zbuffer)[x + y * WIDTH] = z;
-					// map a color from the texture to the pixel we're drawing
-					TGAColor tex_color = texture.get(
-						x_t * (texture.get_width()),
-						y_t * (texture.get_height())
-					);
-
-					// shade
-					// find the pixel's normal (ratio btwn three vertex normals) and interp lighting
-
-					// calculate the distance between point (x,y) and the three face vertices for linear interp
-					auto ad = (Vec3f(x, y, a.z) - a).norm();
-					auto bd = (Vec3f(x, y, b.z) - b).norm();
-					auto cd = (Vec3f(x, y, c.z) - c).norm();
-
-					// multiply vertex normals (xn) by (x,y)'s distance to those vertices
-					auto fragment_normal = an*((ad+bd+cd)/ad) + bn*((ad+bd+cd)/bd) + cn*((ad+bd+cd)/cd);
-					auto fragment_illumination = get_illumination(fragment_normal, light_source);
-
-					// interpolate texel color w/ fragment color from light
-					TGAColor pixel_color(
-						static_cast<unsigned char>(tex_color.r * fragment_illumination.r / 255),
-						static_cast<unsigned char>(tex_color.g * fragment_illumination.g / 255),
-						static_cast<unsigned char>(tex_color.b * fragment_illumination.b / 255),
-						255
-					);
-					// draw
-					image.set(x, y, pixel_color);
-				}
-			}
-		}
-	}
-}
-
-// draw a model to an image
-void draw_model(Model &m, TGAImage &texture, TGAImage &image, std::unique_ptr<std::array<double, AREA>> &zbuffer, Vec3f &light_source) {
-	// for each face
-	// TODO: Models, as declared in model.h, do not have an iterable face collection :(
-	for (auto i = 0; i < m.nfaces(); ++i) {
-		draw_face(*(m.get_face(i)), image, zbuffer, texture, light_source);
-	}
+static void usage(const char *program) {
+	std::cerr << "usage: " << program << " [--size WxH] [--depth float|unorm24] [--threads N] [--raster scalar|sse4|avx2] [--filter nearest|bilinear|trilinear] [--wrap repeat|clamp] [--eye X,Y,Z] [--look-at X,Y,Z] [--light X,Y,Z] [--fov DEG | --ortho SIZE] [--clip NEAR,FAR] [--shade MODE] [--no-cull] [--no-hiz] [--deferred] [--report FILE] [--output FILE] [--format tga|qoi|ppm|pam|y4m] [--fps N] [--band ROWS] [--orbit N | --frames FILE] [--serve [SOCKET]] [--cache-mb N] [--max-mpixels N] [--shard I/N [--split rows|geometry]] [--merge SHARD...] [--bake model.obj [model.rmesh]]\n";
 }
 
 // render an image
+// usage: renderer [--size WxH] [--depth float|unorm24] [--threads N] [--raster scalar|sse4|avx2]
+//                 [--filter nearest|bilinear|trilinear] [--wrap repeat|clamp]
+//                 [--eye X,Y,Z] [--look-at X,Y,Z] [--light X,Y,Z] [--fov DEG | --ortho SIZE] [--clip NEAR,FAR]
+//                 [--shade MODE] [--no-cull] [--no-hiz] [--deferred] [--report FILE]
+//                 [--output FILE] [--format tga|qoi|ppm|pam|y4m] [--fps N] [--band ROWS]
+//                 [--orbit N | --frames FILE] [--serve [SOCKET]] [--cache-mb N] [--max-mpixels N]
+//                 [--shard I/N [--split rows|geometry]] [--merge SHARD...]
+//                 [--bake model.obj [model.rmesh]]
+//   --size WxH   output resolution, 2048x2048 by default
+//   --depth F    depth buffer format, 32 bit float (the default) or 24 bit integer
+//   --threads N  rasterize on N threads, 0 (the default) uses every core and 1 draws serially
+//   --raster K   pixel kernel to rasterize with, defaults to the widest the cpu supports.
+//                every kernel draws exactly the same image. one the cpu can't run falls back to the
+//                widest it can
+//   --filter F   texture filtering, nearest by default. trilinear picks mip levels by how many
+//                texels fall under a pixel
+//   --wrap W     what texture coordinates outside [0, 1] do, repeat by default
+//   --eye P      where the camera sits, 0,0,4 by default
+//   --look-at P  what it looks at, the origin by default. it can't be where the eye is
+//   --light P    where the light is, shining towards the origin, 3,0,1 by default
+//   --fov DEG    perspective projection spanning DEG (under 180) degrees across the smaller side
+//                of the image (about 28, a focal length of 4, by default)
+//   --ortho SIZE orthographic projection spanning SIZE units across the smaller side instead
+//   --clip N,F   near and far clip distances, 2,inf by default. depth is 1 at N and 0 at F
+//   --shade MODE depth, flat, gouraud, phong, textured or textured-phong (the default)
+//   --no-cull    draw back faces too, for meshes that aren't closed
+//   --no-hiz     depth test every pixel rather than skipping blocks hierarchical z rules out.
+//                the image doesn't change, only the time it takes
+//   --deferred   depth test everything first and shade each pixel once afterwards, instead of
+//                shading every fragment that passes. same image, less shading under overdraw
+//   --report F   write the frame's settings, stage times, counters and peak heap use to F as
+//                json, - for stdout. times and pixel counts need a build with RENDERER_INSTRUMENT
+//   --output F   where to write the image, ../data/output.tga by default, - for stdout
+//   --format F   what to write it as, tga (rle), qoi, ppm or pam (both uncompressed, for piping)
+//                or y4m (yuv 4:2:0 video frames). by default the output's extension decides, tga
+//                if it has none that does. ppm, pam and y4m are written as a stream of frames,
+//                so the output can be a pipe into a video encoder, e.g.
+//                --output - --format y4m | ffmpeg -i - out.mp4
+//   --fps N      frame rate a y4m stream says it has, 30 by default
+//   --band ROWS  render ROWS rows at a time, writing each band out as soon as it's drawn, so
+//                memory goes with the band and not the whole image. for posters too big to
+//                hold at once. the image is the same
+//   --orbit N    render N frames circling the camera once around what it looks at, loading the
+//                model and texture only once. frames render side by side on the threads, each
+//                to its own numbered file (output_0000.tga and on, or put a %04d in --output),
+//                or all into one stream for ppm, pam and y4m
+//   --frames F   the same for the frames listed in the file F, a line each of any of
+//                "eye X,Y,Z", "look-at X,Y,Z" and "light X,Y,Z", the rest as given here
+//   --serve [S]  stay up as a render server, taking jobs as lines of json on the unix socket S,
+//                or stdin without one, and answering each when it's written (see server.h).
+//                everything above sets what a job gets unless it says otherwise
+//   --cache-mb N how many megabytes of models and textures the server keeps loaded, 512 by
+//                default. the least recently used go first
+//   --max-mpixels N the most megapixels a server job can ask for, 64 by default
+//   --shard I/N  render only shard I (from 0) of N of the image, writing its color and depth to
+//                --output, for N processes (or machines) to share one big frame
+//   --split S    how shards divide the frame: rows (the default) gives each a band of the
+//                image, geometry a run of its triangles over the whole image
+//   --merge F... put shard files back together into the image --output and --format ask for,
+//                bit-identical to rendering it in one go. shards rendered with different settings
+//                are refused
+//                e.g. for i in 0 1 2; do renderer --shard $i/3 --output s$i.rshard & done; wait
+//                     renderer --merge s0.rshard s1.rshard s2.rshard --output out.tga
+//   --bake F [O] convert the .obj F to a baked mesh O (next to F by default) and exit.
+//                a bake next to an .obj is picked up automatically while it's up to date
 int main(int argc, char *argv[]) {
 
+	auto width = DEFAULT_WIDTH;
+	auto height = DEFAULT_HEIGHT;
+	auto depth_format = DEPTH_FLOAT32;
+	auto nthreads = 0;
+	auto filter = FILTER_NEAREST;
+	auto wrap = WRAP_REPEAT;
+	auto shade_mode = SHADE_TEXTURED_PHONG;
+	auto options = RasterOptions{detect_raster_isa(), true, false, true};
+	Camera camera;
+	auto eye = Vec3f(0, 0, 4);
+	auto target = Vec3f(0, 0, 0);
+	float fov = 0, ortho = 0, near = 2, far = INFINITY;
+	const char *report_path = nullptr;
+	std::string output_path = "../data/output.tga";
+	const char *output_format = nullptr;
+	auto fps = 30;
+	auto band_rows = 0;
+	auto orbit = 0;
+	const char *frame_list = nullptr;
 	// create a light source
 	// points from here towards origin
 	// ignores occlusion
 	// should make this a class
 	auto light_source = Vec3f(3.0, 0.0, 1.0);
 	//auto light_color = TGAColor(200, 200, 200);
+	auto serving = false;
+	const char *socket_path = nullptr;
+	auto cache_mb = 512;
+	auto max_mpixels = 64;
+	auto shard = -1, shard_count = 0;
+	auto split = SHARD_ROWS;
+	std::vector<std::string> merge;
+	const char *bake_source = nullptr;
+	std::string bake_target;
+	for (auto i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--size") && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--depth") && i + 1 < argc && known_name(argv[i + 1], parse_depth_format, depth_format_name)) {
+			depth_format = parse_depth_format(argv[++i]);
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			nthreads = std::atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--raster") && i + 1 < argc && known_raster_isa(argv[i + 1])) {
+			options.isa = parse_raster_isa(argv[++i]);
+		} else if (!strcmp(argv[i], "--filter") && i + 1 < argc && known_name(argv[i + 1], parse_texture_filter, texture_filter_name)) {
+			filter = parse_texture_filter(argv[++i]);
+		} else if (!strcmp(argv[i], "--wrap") && i + 1 < argc && known_name(argv[i + 1], parse_texture_wrap, texture_wrap_name)) {
+			wrap = parse_texture_wrap(argv[++i]);
+		} else if (!strcmp(argv[i], "--eye") && i + 1 < argc && sscanf(argv[i + 1], "%f,%f,%f", &eye.x, &eye.y, &eye.z) == 3) {
+			++i;
+		} else if (!strcmp(argv[i], "--look-at") && i + 1 < argc && sscanf(argv[i + 1], "%f,%f,%f", &target.x, &target.y, &target.z) == 3) {
+			++i;
+		} else if (!strcmp(argv[i], "--light") && i + 1 < argc && sscanf(argv[i + 1], "%f,%f,%f", &light_source.x, &light_source.y, &light_source.z) == 3 && light_source.norm() > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--fov") && i + 1 < argc && Camera::valid_fov(fov = float(std::atof(argv[i + 1])))) {
+			++i;
+		} else if (!strcmp(argv[i], "--ortho") && i + 1 < argc && (ortho = float(std::atof(argv[i + 1]))) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--clip") && i + 1 < argc && sscanf(argv[i + 1], "%f,%f", &near, &far) == 2 && near > 0 && far > near) {
+			++i;
+		} else if (!strcmp(argv[i], "--shade") && i + 1 < argc && known_name(argv[i + 1], parse_shade_mode, shade_mode_name)) {
+			shade_mode = parse_shade_mode(argv[++i]);
+		} else if (!strcmp(argv[i], "--no-cull")) {
+			options.cull = false;
+		} else if (!strcmp(argv[i], "--no-hiz")) {
+			options.hiz = false;
+		} else if (!strcmp(argv[i], "--deferred")) {
+			options.deferred = true;
+		} else if (!strcmp(argv[i], "--report") && i + 1 < argc) {
+			report_path = argv[++i];
+		} else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (!strcmp(argv[i], "--format") && i + 1 < argc && known_name(argv[i + 1], parse_image_format, image_format_name)) {
+			output_format = argv[++i];
+		} else if (!strcmp(argv[i], "--fps") && i + 1 < argc && (fps = std::atoi(argv[i + 1])) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--band") && i + 1 < argc && (band_rows = std::atoi(argv[i + 1])) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--orbit") && i + 1 < argc && (orbit = std::atoi(argv[i + 1])) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+			frame_list = argv[++i];
+		} else if (!strcmp(argv[i], "--serve")) {
+			serving = true;
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2)) socket_path = argv[++i];
+		} else if (!strcmp(argv[i], "--cache-mb") && i + 1 < argc && (cache_mb = std::atoi(argv[i + 1])) >= 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--max-mpixels") && i + 1 < argc && (max_mpixels = std::atoi(argv[i + 1])) > 0) {
+			++i;
+		} else if (!strcmp(argv[i], "--shard") && i + 1 < argc && sscanf(argv[i + 1], "%d/%d", &shard, &shard_count) == 2 && shard >= 0 && shard < shard_count) {
+			++i;
+		} else if (!strcmp(argv[i], "--split") && i + 1 < argc && known_name(argv[i + 1], parse_shard_split, shard_split_name)) {
+			split = parse_shard_split(argv[++i]);
+		} else if (!strcmp(argv[i], "--merge") && i + 1 < argc) {
+			while (i + 1 < argc && strncmp(argv[i + 1], "--", 2)) merge.push_back(argv[++i]);
+		} else if (!strcmp(argv[i], "--bake") && i + 1 < argc) {
+			bake_source = argv[++i];
+			bake_target = mesh_cache_path(bake_source);
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2)) bake_target = argv[++i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!Camera::valid_view(eye, target)) {
+		usage(argv[0]);
+		return 1;
+	}
+	ThreadPool pool(nthreads);
+	camera.look_at(eye, target);
+	if (ortho > 0) {
+		camera.set_orthographic(ortho, near, far);
+	} else if (fov > 0) {
+		camera.set_perspective(fov, near, far);
+	} else {
+		camera.set_clip_planes(near, far);
+	}
 
-	// load model
-	// TODO: this boilerplate is not ideal, i should rewrite it
-	auto model = Model("../data/african_head.obj");
+	if (bake_source) {
+		MeshData mesh;
+		if (!load_obj(bake_source, mesh, &pool)) return 1;
+		if (!write_mesh_cache(bake_target.c_str(), mesh, bake_source)) return 1;
+		std::cerr << "# baked " << bake_source << " to " << bake_target << "\n";
+		return 0;
+	}
 
-	// load texture
-	auto texture = TGAImage();
-	texture.read_tga_file("../data/african_head_diffuse.tga");
-	texture.flip_vertically();
+	if (!merge.empty()) {
+		TGAImage merged;
+		if (!merge_shards(merge, merged)) return 1;
+		auto format = output_format ? parse_image_format(output_format) : image_format_for_path(output_path);
+		return write_image(output_path.c_str(), format, merged, true, &pool) ? 0 : 1;
+	}
 
-	// init output image
-	auto image = TGAImage(WIDTH, HEIGHT, TGAImage::RGB);
 	// fill the image with a background color because the glare on my screen is fierce
-	for (auto i = 0; i < WIDTH; ++i) {
-		for (auto j = 0; j < HEIGHT; ++j) {
-			image.set(i, j, TGAColor(200, 200, 200, 255));
+	auto background = TGAColor(200, 200, 200, 255);
+	auto model_path = "../data/african_head.obj";
+	auto texture_path = "../data/african_head_diffuse.tga";
+
+	if (serving) {
+		// the settings given here are where every job starts from
+		auto defaults = RenderJob{model_path, texture_path, output_path, output_format ? output_format : "", width, height, eye, target, light_source,
+			fov, ortho, near, far, shade_mode, filter, wrap, depth_format, background};
+		return serve(socket_path, defaults, options, static_cast<long long>(max_mpixels) << 20, static_cast<size_t>(cache_mb) << 20, pool) ? 0 : 1;
+	}
+
+	// the frames of a batch, if there's one
+	std::vector<BatchFrame> frames;
+	auto batch = orbit > 0 || frame_list;
+	if (batch) {
+		auto first = BatchFrame{eye, target, light_source};
+		if (orbit > 0) {
+			frames = orbit_frames(first, orbit);
+		} else if (!read_frame_list(frame_list, first, frames)) {
+			return 1;
+		}
+		if (band_rows > 0) {
+			std::cerr << "--band draws a single image, not a batch of frames\n";
+			return 1;
 		}
 	}
-	// init image z buffer
-	auto zbuffer = std::make_unique<std::array<double, AREA>>();
-	zbuffer->fill(0);
 
-	// draw model to image
-	draw_model(model, texture, image, zbuffer, light_source);
+	// load model
+	// TODO: this boilerplate is not ideal, i should rewrite it
+	RenderStats stats;
+	StageTimer load_timer(stats.times, STAGE_LOAD);
+	Model model(model_path, &pool);
+	load_timer.stop();
+
+	// load texture, then convert it for sampling
+	StageTimer texture_timer(stats.times, STAGE_TEXTURE);
+	auto diffuse = TGAImage();
+	diffuse.read_tga_file(texture_path);
+	diffuse.flip_vertically();
+	Texture texture(diffuse, filter, wrap);
+	texture_timer.stop();
 
-	// write image to file
-	image.flip_vertically();
-	image.write_tga_file("../data/output.tga");
+	auto format = output_format ? parse_image_format(output_format) : image_format_for_path(output_path);
+	if (shard_count > 0) {
+		if (batch || band_rows > 0 || (split == SHARD_ROWS && shard_count > height)) {
+			std::cerr << "--shard splits a single image, into no more row shards than it has rows\n";
+			return 1;
+		}
+		// everything else the picture depends on, so shards of different renders can't be merged.
+		// the raster kernel, hi-z and deferred shading don't change a pixel, so shards may differ there
+		std::ostringstream settings;
+		settings << std::hexfloat << model_path << "\n" << texture_path << "\n" << shade_mode_name(shade_mode) << " " << texture_filter_name(filter) << " " << texture_wrap_name(wrap)
+			<< " " << options.cull << "\n" << eye.x << " " << eye.y << " " << eye.z << " " << target.x << " " << target.y << " " << target.z << " " << light_source.x << " "
+			<< light_source.y << " " << light_source.z << "\n" << fov << " " << ortho << " " << near << " " << far << "\n";
+		if (!render_shard(shade_mode, model, camera, texture, light_source.normalize(), background, width, height, depth_format, pool, options, shard, shard_count, split,
+			shard_settings_hash(settings.str()), output_path.c_str(), stats)) return 1;
+		std::cerr << stats;
+	} else if (batch) {
+		// every frame from the one model and texture
+		if (!render_batch(shade_mode, model, camera, texture, background, width, height, depth_format, pool, options, frames, output_path, format, fps, stats)) return 1;
+		std::cerr << stats;
+	} else if (band_rows > 0) {
+		// draw and write the image a band at a time
+		ImageStream out;
+		if (!out.open(output_path.c_str(), format, width, height, TGAImage::RGB, &pool)) return 1;
+		if (!render_banded(shade_mode, model, camera, texture, light_source.normalize(), background, width, height, band_rows, depth_format, pool, options, out, stats)) return 1;
+		if (!out.close()) return 1;
+		std::cerr << stats;
+	} else {
+		// init output image and z buffer. it comes from the output queue, which writes it out in
+		// the background and hands it back for another frame
+		OutputQueue output(2, TILE_SIZE, &pool);
+		FrameStream stream;
+		auto streaming = FrameStream::streams(format);
+		if (streaming && !stream.open(output_path.c_str(), format, width, height, TGAImage::RGB, fps)) return 1;
+		auto &fb = output.acquire(width, height, depth_format);
+		fb.clear(background);
+
+		// draw model to image
+		draw_scene(shade_mode, model, camera, texture, light_source.normalize(), fb, pool, options, stats);
+		{
+			StageTimer timer(stats.times, STAGE_ENCODE);
+			fb.resolve();
+		}
+		std::cerr << stats;
+
+		// write image to file, row 0 at the bottom as drawn
+		if (streaming) {
+			output.submit(fb, stream);
+		} else {
+			output.submit(fb, output_path, format);
+		}
+		if (!output.finish()) return 1;
+		if (streaming && !stream.close()) return 1;
+		stats.times.add(output.write_times());
+	}
+
+	if (report_path) {
+		ReportSettings settings{model_path, width, height, pool.size(), raster_isa_name(options.isa), depth_format_name(depth_format),
+			shade_mode_name(shade_mode), texture_filter_name(filter), texture_wrap_name(wrap), options.hiz, options.deferred, options.cull, band_rows, batch ? static_cast<int>(frames.size()) : 1};
+		if (!write_report(report_path, settings, stats)) return 1;
+	}
 	return 0;
 }
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_file.h"
+
+MappedFile::MappedFile() : data(nullptr), length(0), fd(-1) {
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char *filename, bool sequential) {
+	close();
+	fd = ::open(filename, O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		std::cerr << "can't stat file " << filename << "\n";
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(st.st_size);
+	// mmap refuses zero length mappings, an empty file is just an empty view
+	if (length == 0) return true;
+	auto p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+		std::cerr << "can't map file " << filename << "\n";
+		close();
+		return false;
+	}
+	if (sequential) madvise(p, length, MADV_SEQUENTIAL);
+	data = static_cast<const char *>(p);
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) munmap(const_cast<char *>(data), length);
+	if (fd >= 0) ::close(fd);
+	data = nullptr;
+	length = 0;
+	fd = -1;
+}
+
+bool MappedFile::is_open() {
+	return fd >= 0;
+}
+
+const char *MappedFile::begin() {
+	return data;
+}
+
+const char *MappedFile::end() {
+	return data + length;
+}
+
+size_t MappedFile::size() {
+	return length;
+}
@@ -0,0 +1,26 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+
+// a read-only view of a whole file, memory-mapped so the kernel pages it in on demand
+class MappedFile {
+private:
+	const char *data;
+	size_t length;
+	int fd;
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator =(const MappedFile &) = delete;
+	// sequential hints the kernel to read ahead, for files that get read front to back
+	bool open(const char *filename, bool sequential = false);
+	void close();
+	bool is_open();
+	const char *begin();
+	const char *end();
+	size_t size();
+};
+
+#endif //__MAPPED_FILE_H__
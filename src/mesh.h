@@ -0,0 +1,46 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+
+#include <vector>
+
+// a triangle mesh as flat arrays: one array per vertex attribute component, and 3 indices per
+// triangle into positions, texture coordinates and normals. a missing texture coordinate or
+// normal index is -1
+struct MeshData {
+	std::vector<float> vx, vy, vz; // positions
+	std::vector<float> tu, tv;     // texture coordinates
+	std::vector<float> nx, ny, nz; // normals
+	std::vector<int> vfaces;
+	std::vector<int> vtfaces;
+	std::vector<int> vnfaces;
+};
+
+// read-only pointers to a mesh laid out like MeshData, wherever its arrays happen to live
+// (a MeshData, or a memory-mapped baked mesh file)
+struct MeshView {
+	const float *vx, *vy, *vz;
+	const float *tu, *tv;
+	const float *nx, *ny, *nz;
+	const int *vfaces;
+	const int *vtfaces;
+	const int *vnfaces;
+	int nverts;
+	int nuvs;
+	int nnormals;
+	int nfaces;
+};
+
+inline MeshView view_of(const MeshData &m) {
+	return MeshView{
+		m.vx.data(), m.vy.data(), m.vz.data(),
+		m.tu.data(), m.tv.data(),
+		m.nx.data(), m.ny.data(), m.nz.data(),
+		m.vfaces.data(), m.vtfaces.data(), m.vnfaces.data(),
+		static_cast<int>(m.vx.size()),
+		static_cast<int>(m.tu.size()),
+		static_cast<int>(m.nx.size()),
+		static_cast<int>(m.vfaces.size() / 3)
+	};
+}
+
+#endif //__MESH_H__
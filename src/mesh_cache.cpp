@@ -0,0 +1,174 @@
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "mesh_cache.h"
+#include "mapped_file.h"
+
+static const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+static uint64_t align_up(uint64_t n) {
+	return (n + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+static bool stat_file(const char *filename, int64_t &mtime_ns, uint64_t &size) {
+	struct stat st;
+	if (!filename || stat(filename, &st) != 0) return false;
+	mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	size = static_cast<uint64_t>(st.st_size);
+	return true;
+}
+
+std::string mesh_cache_path(const char *obj_filename) {
+	std::string path(obj_filename);
+	auto dot = path.rfind('.');
+	auto slash = path.rfind('/');
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+		path.erase(dot);
+	}
+	return path + ".rmesh";
+}
+
+bool write_mesh_cache(const char *filename, const MeshData &mesh, const char *source_filename) {
+	const void *arrays[MESH_CACHE_ARRAYS] = {
+		mesh.vx.data(), mesh.vy.data(), mesh.vz.data(),
+		mesh.tu.data(), mesh.tv.data(),
+		mesh.nx.data(), mesh.ny.data(), mesh.nz.data(),
+		mesh.vfaces.data(), mesh.vtfaces.data(), mesh.vnfaces.data()
+	};
+	uint64_t sizes[MESH_CACHE_ARRAYS] = {
+		mesh.vx.size() * sizeof(float), mesh.vy.size() * sizeof(float), mesh.vz.size() * sizeof(float),
+		mesh.tu.size() * sizeof(float), mesh.tv.size() * sizeof(float),
+		mesh.nx.size() * sizeof(float), mesh.ny.size() * sizeof(float), mesh.nz.size() * sizeof(float),
+		mesh.vfaces.size() * sizeof(int), mesh.vtfaces.size() * sizeof(int), mesh.vnfaces.size() * sizeof(int)
+	};
+
+	MeshCacheHeader header;
+	memset((void *)&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.byte_order = MESH_CACHE_BYTE_ORDER;
+	header.nverts = mesh.vx.size();
+	header.nuvs = mesh.tu.size();
+	header.nnormals = mesh.nx.size();
+	header.nfaces = mesh.vfaces.size() / 3;
+	stat_file(source_filename, header.source_mtime_ns, header.source_size);
+	auto offset = align_up(sizeof(header));
+	for (auto i = 0; i < MESH_CACHE_ARRAYS; ++i) {
+		header.offsets[i] = offset;
+		offset = align_up(offset + sizes[i]);
+	}
+
+	std::ofstream out;
+	out.open(filename, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+	const char padding[MESH_CACHE_ALIGNMENT] = {0};
+	uint64_t written = 0;
+	out.write((const char *)&header, sizeof(header));
+	written += sizeof(header);
+	for (auto i = 0; i < MESH_CACHE_ARRAYS; ++i) {
+		out.write(padding, header.offsets[i] - written);
+		out.write((const char *)arrays[i], sizes[i]);
+		written = header.offsets[i] + sizes[i];
+	}
+	out.write(padding, align_up(written) - written);
+	if (!out.good()) {
+		std::cerr << "can't write the baked mesh " << filename << "\n";
+		return false;
+	}
+	out.close();
+	return true;
+}
+
+bool map_mesh_cache(const char *filename, MappedFile &file, MeshView &view, const char *source_filename) {
+	// when looking for a bake next to an .obj, a missing one isn't worth complaining about
+	int64_t source_mtime = 0;
+	uint64_t source_size = 0;
+	if (source_filename) {
+		int64_t mtime;
+		uint64_t size;
+		if (!stat_file(filename, mtime, size) || !stat_file(source_filename, source_mtime, source_size)) return false;
+	}
+	if (!file.open(filename)) return false;
+
+	if (file.size() < sizeof(MeshCacheHeader)) {
+		std::cerr << "baked mesh " << filename << " is too short\n";
+		file.close();
+		return false;
+	}
+	auto header = reinterpret_cast<const MeshCacheHeader *>(file.begin());
+	if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) || header->version != MESH_CACHE_VERSION || header->byte_order != MESH_CACHE_BYTE_ORDER) {
+		std::cerr << "baked mesh " << filename << " has the wrong magic, version or byte order\n";
+		file.close();
+		return false;
+	}
+
+	// a bake of an older version of the source is stale, leave it be
+	if (source_filename && (header->source_mtime_ns != source_mtime || header->source_size != source_size)) {
+		file.close();
+		return false;
+	}
+
+	// the counts have to fit the ints MeshView holds them in, faces' 3 indices each too, before
+	// anything is worked out from them
+	if (header->nverts > INT_MAX || header->nuvs > INT_MAX || header->nnormals > INT_MAX || header->nfaces > INT_MAX / 3) {
+		std::cerr << "baked mesh " << filename << " is corrupt\n";
+		file.close();
+		return false;
+	}
+
+	// every array has to sit inside the file, aligned for its element type
+	uint64_t counts[MESH_CACHE_ARRAYS] = {
+		header->nverts, header->nverts, header->nverts,
+		header->nuvs, header->nuvs,
+		header->nnormals, header->nnormals, header->nnormals,
+		header->nfaces * 3, header->nfaces * 3, header->nfaces * 3
+	};
+	const void *arrays[MESH_CACHE_ARRAYS];
+	for (auto i = 0; i < MESH_CACHE_ARRAYS; ++i) {
+		auto offset = header->offsets[i];
+		if (offset % 4 || offset > file.size() || counts[i] * 4 > file.size() - offset) {
+			std::cerr << "baked mesh " << filename << " is corrupt\n";
+			file.close();
+			return false;
+		}
+		arrays[i] = file.begin() + offset;
+	}
+
+	// and every face has to index inside them, as load_obj makes sure of for an .obj. the file
+	// is mapped read-only, so a bad face can't be dropped the way it is there, only the file
+	auto vfaces = static_cast<const int *>(arrays[8]);
+	auto vtfaces = static_cast<const int *>(arrays[9]);
+	auto vnfaces = static_cast<const int *>(arrays[10]);
+	auto nv = static_cast<int64_t>(header->nverts);
+	auto nvt = static_cast<int64_t>(header->nuvs);
+	auto nvn = static_cast<int64_t>(header->nnormals);
+	for (uint64_t k = 0; k < counts[8]; ++k) {
+		if (vfaces[k] < 0 || vfaces[k] >= nv || vtfaces[k] < -1 || vtfaces[k] >= nvt || vnfaces[k] < -1 || vnfaces[k] >= nvn) {
+			std::cerr << "baked mesh " << filename << " is corrupt, face " << k / 3 << " indexes past its vertices\n";
+			file.close();
+			return false;
+		}
+	}
+
+	view.vx = static_cast<const float *>(arrays[0]);
+	view.vy = static_cast<const float *>(arrays[1]);
+	view.vz = static_cast<const float *>(arrays[2]);
+	view.tu = static_cast<const float *>(arrays[3]);
+	view.tv = static_cast<const float *>(arrays[4]);
+	view.nx = static_cast<const float *>(arrays[5]);
+	view.ny = static_cast<const float *>(arrays[6]);
+	view.nz = static_cast<const float *>(arrays[7]);
+	view.vfaces = static_cast<const int *>(arrays[8]);
+	view.vtfaces = static_cast<const int *>(arrays[9]);
+	view.vnfaces = static_cast<const int *>(arrays[10]);
+	view.nverts = static_cast<int>(header->nverts);
+	view.nuvs = static_cast<int>(header->nuvs);
+	view.nnormals = static_cast<int>(header->nnormals);
+	view.nfaces = static_cast<int>(header->nfaces);
+	return true;
+}
@@ -0,0 +1,45 @@
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include <cstdint>
+#include <string>
+#include "mesh.h"
+
+class MappedFile;
+
+// baked meshes are a header followed by MeshData's arrays, each starting on a 64 byte boundary,
+// in native byte order. they can be mapped and drawn from directly, with nothing to parse or copy
+const char MESH_CACHE_MAGIC[8] = {'R', 'M', 'E', 'S', 'H', 0, 0, 0};
+const uint32_t MESH_CACHE_VERSION = 2;
+const uint32_t MESH_CACHE_BYTE_ORDER = 0x01020304;
+const int MESH_CACHE_ARRAYS = 11; // vx vy vz tu tv nx ny nz vfaces vtfaces vnfaces
+
+#pragma pack(push,1)
+struct MeshCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;      // MESH_CACHE_BYTE_ORDER as written, a mismatch means the wrong endianness
+	uint64_t nverts;
+	uint64_t nuvs;
+	uint64_t nnormals;
+	uint64_t nfaces;
+	uint64_t offsets[MESH_CACHE_ARRAYS]; // where each array starts, from the start of the file
+	// the .obj this was baked from, when it was baked (its mtime in nanoseconds, so an edit within
+	// the same second still counts). used to tell if the bake is stale
+	int64_t source_mtime_ns;
+	uint64_t source_size;
+};
+#pragma pack(pop)
+
+// where the baked version of an .obj lives: the same path with .rmesh in place of .obj
+std::string mesh_cache_path(const char *obj_filename);
+
+// write mesh out as a baked mesh file, remembering which .obj (if any) it came from
+bool write_mesh_cache(const char *filename, const MeshData &mesh, const char *source_filename);
+
+// map a baked mesh file and point view at its arrays. if source_filename is given, the bake must
+// have been made from that file as it is now. a file with a face indexing past its arrays is
+// refused as corrupt. the arrays stay valid as long as file stays open
+bool map_mesh_cache(const char *filename, MappedFile &file, MeshView &view, const char *source_filename = nullptr);
+
+#endif //__MESH_CACHE_H__
@@ -1,117 +1,82 @@
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <utility>
 #include <vector>
 #include "model.h"
+#include "obj_loader.h"
+#include "mesh_cache.h"
 
 /**
- * Read in a .obj file
+ * Read in a .obj file (see load_obj), or map a baked mesh (see map_mesh_cache)
  */
-Model::Model(const char *filename) : verts_(), vfaces_() {
-  std::ifstream in;
-
-  // open the file
-  in.open(filename, std::ifstream::in);
-  if (in.fail()) return;
-
-  // for each line
-  std::string line;
-  while (!in.eof()) {
-    std::getline(in, line);
-    std::istringstream iss(line.c_str());
-    char trash;
-
-    // store positional vertices, eg:
-    // v 0.460214 0.163208 -0.055258
-    if (!line.compare(0, 2, "v ")) {
-      iss >> trash; // throw out the first character
-      // store 3 whitespace-delimited strings. hooray stringstreams!
-      Vec3f v;
-      for (int i=0;i<3;i++) iss >> v.raw[i];
-      verts_.push_back(v);
-    }
+Model::Model(const char *filename, ThreadPool *pool) : view_(view_of(mesh_)) {
+  std::string name(filename);
+  auto baked = name.size() >= 6 && !name.compare(name.size() - 6, 6, ".rmesh");
+  if (baked) {
+    if (!map_mesh_cache(filename, mapped_, view_)) return;
+  } else if (map_mesh_cache(mesh_cache_path(filename).c_str(), mapped_, view_, filename)) {
+    std::cerr << "# using baked mesh " << mesh_cache_path(filename) << "\n";
+  } else {
+    if (!load_obj(filename, mesh_, pool)) return;
+    view_ = view_of(mesh_);
+  }
+  std::cerr << "# v# " << nverts() << " f# "  << nfaces() << std::endl;
+}
 
-    // store texture vertices, eg:
-    // vt  0.550 0.946 0.000
-    else if (!line.compare(0, 3, "vt ")) {
-      iss >> trash >> trash; // throw out the first two characters
-      Vec3f v;
-      for (int i=0;i<3;i++) iss >> v.raw[i];
-      verts_t_.push_back(v);
-    }
+Model::Model(MeshData mesh) : mesh_(std::move(mesh)), view_(view_of(mesh_)) {
+}
 
-    // store normal vertices, eg:
-    // vn  -0.184 0.792 0.581
-    else if (!line.compare(0, 3, "vn ")) {
-      iss >> trash >> trash; // throw out the first two characters
-      Vec3f v;
-      for (int i=0;i<3;i++) iss >> v.raw[i];
-      verts_n_.push_back(v);
-    }
+Model::~Model() {
+}
 
-    // store faces
-    // faces are indices into v, vt, and vn
-    // f 1106/1145/1106 1136/1182/1136 1132/1178/1132
-    //     v0/ vt0/ vn0   v1/ vt1/ vn1   v2/ vt2/ vn2
-    else if (!line.compare(0, 2, "f ")) {
-      std::vector<int> f_v;
-      std::vector<int> f_vt;
-      std::vector<int> f_vn;
-      int v_index, vt_index, vn_index;
-      iss >> trash; // throw out the 'f'
-      while (iss >> v_index >> trash >> vt_index >> trash >> vn_index) { // trash the slash
-        // in wavefront obj all indices start at 1, not zero
-        // push em back
-        f_v.push_back(v_index-1);
-        f_vt.push_back(vt_index-1);
-        f_vn.push_back(vn_index-1);
-      }
-      vfaces_.push_back(f_v);
-      vtfaces_.push_back(f_vt);
-      vnfaces_.push_back(f_vn);
-    }
-  }
-  std::cerr << "# v# " << verts_.size() << " f# "  << vfaces_.size() << std::endl;
+const MeshData &Model::mesh_data() {
+  return mesh_;
 }
 
-Model::~Model() {
+const MeshView &Model::mesh() {
+  return view_;
 }
 
 int Model::nverts() {
-  return (int)verts_.size();
+  return view_.nverts;
 }
 
 int Model::nfaces() {
-  return (int)vfaces_.size();
+  return view_.nfaces;
+}
+
+size_t Model::memory_size() {
+  auto &m = mesh_;
+  auto floats = m.vx.size() + m.vy.size() + m.vz.size() + m.tu.size() + m.tv.size() + m.nx.size() + m.ny.size() + m.nz.size();
+  auto ints = m.vfaces.size() + m.vtfaces.size() + m.vnfaces.size();
+  return floats * sizeof(float) + ints * sizeof(int) + mapped_.size();
 }
 
-// returns a vector of vertex position indices 
-std::vector<int> Model::face_v(int i) {
-  return vfaces_[i];
+// returns a pointer to face i's 3 vertex position indices
+const int *Model::face_v(int i) {
+  return view_.vfaces + i * 3;
 }
 
-std::vector<int> Model::face_vt(int i) {
-  return vtfaces_[i];
+const int *Model::face_vt(int i) {
+  return view_.vtfaces + i * 3;
 }
 
-std::vector<int> Model::face_vn(int i) {
-  return vnfaces_[i];
+const int *Model::face_vn(int i) {
+  return view_.vnfaces + i * 3;
 }
 
 Vec3f Model::vert(int i) {
-  return verts_[i];
+  return Vec3f(view_.vx[i], view_.vy[i], view_.vz[i]);
 }
 
+// a missing (-1) texture coordinate reads as (0, 0)
 Vec3f Model::vert_t(int i) {
-  return verts_t_[i];
+  if (i < 0) return Vec3f();
+  return Vec3f(view_.tu[i], view_.tv[i], 0);
 }
 
+// a missing (-1) normal reads as (0, 0, 0)
 Vec3f Model::vert_n(int i) {
-  return verts_n_[i];
+  if (i < 0) return Vec3f();
+  return Vec3f(view_.nx[i], view_.ny[i], view_.nz[i]);
 }
-
-std::unique_ptr<Face> Model::get_face(int i) {
-  return std::make_unique<Face>(*this, i);
-}
-
@@ -3,32 +3,45 @@
 
 #include <vector>
 #include "geometry.h"
-#include "face.h"
+#include "mapped_file.h"
+#include "mesh.h"
 
-class Face;
+class ThreadPool;
 
-// this has a small memory footprint which is nice but not fun to work with
+// vertex attributes are kept as struct-of-arrays (one flat array per component) and faces as
+// flat index buffers holding 3 indices per triangle, so reading a face never touches the heap.
+// the arrays either belong to the model (parsed from an .obj) or are a baked .rmesh file mapped
+// straight into memory
 class Model {
 private:
-	std::vector<Vec3f> verts_;    // vertices (x, y, z)
-	std::vector<Vec3f> verts_t_;  // vertices (u, w, 0)
-	std::vector<Vec3f> verts_n_;  // vertices (x, y, z)
-	std::vector<std::vector<int>> vfaces_; // indices for positions(x,y,z) of each face vertex
-	std::vector<std::vector<int>> vtfaces_;
-	std::vector<std::vector<int>> vnfaces_;
+	MeshData mesh_;     // the arrays, when parsed from an .obj or handed over
+	MappedFile mapped_; // the arrays, when mapped from a baked mesh
+	MeshView view_;     // points at whichever of the two holds the data
 
 public:
-	Model(const char *filename);
+	// load an .obj, or a baked .rmesh. an .obj with an up to date bake next to it loads the bake.
+	// pool, if given, parses big .obj files in parallel
+	Model(const char *filename, ThreadPool *pool = nullptr);
+	// take a mesh built in memory
+	explicit Model(MeshData mesh);
 	~Model();
+	Model(const Model &) = delete;
+	Model & operator =(const Model &) = delete;
+	// the parsed .obj, empty for a mapped model
+	const MeshData &mesh_data();
+	// the arrays, wherever they live
+	const MeshView &mesh();
 	int nverts();
 	int nfaces();
+	// bytes its arrays take, parsed or mapped
+	size_t memory_size();
 	Vec3f vert(int i);
 	Vec3f vert_t(int i);
 	Vec3f vert_n(int i);
-	std::vector<int> face_v(int i);
-	std::vector<int> face_vt(int i);
-	std::vector<int> face_vn(int i);
-	std::unique_ptr<Face> get_face(int i);
+	// the 3 indices of face i
+	const int *face_v(int i);
+	const int *face_vt(int i);
+	const int *face_vn(int i);
 };
 
 #endif
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "obj_loader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+// files smaller than this aren't worth splitting up
+static const size_t PARALLEL_MIN_BYTES = 1 << 20;
+// chunks handed to each thread, more than one so a slow chunk doesn't hold everyone up
+static const int CHUNKS_PER_THREAD = 4;
+
+// the part of a file parsed by one thread
+struct ObjChunk {
+	MeshData mesh;
+	// negative indices count back from the end of the vertices read so far, which a chunk only
+	// knows for itself. these are the spots in the face arrays holding such an index, already
+	// resolved against this chunk's counts; merging adds on the counts of every earlier chunk
+	std::vector<size_t> relative_v;
+	std::vector<size_t> relative_vt;
+	std::vector<size_t> relative_vn;
+};
+
+// one corner of a polygon, before triangulation
+struct ObjCorner {
+	int v, vt, vn;
+	bool relative_v, relative_vt, relative_vn;
+};
+
+static const double powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+// parse a number like -1.25e-3 at p, leaving p just past it. no locale, no allocation
+static bool parse_float(const char *&p, const char *end, float &out) {
+	while (p < end && is_space(*p)) ++p;
+	auto negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+
+	// gather up to 19 significant digits (all that fit in 64 bits) and a decimal exponent
+	uint64_t mantissa = 0;
+	auto significant = 0;
+	auto exponent = 0;
+	auto any = false;
+	for (; p < end && is_digit(*p); ++p) {
+		any = true;
+		if (significant < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa) ++significant;
+		} else {
+			++exponent;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && is_digit(*p); ++p) {
+			any = true;
+			if (significant < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) ++significant;
+				--exponent;
+			}
+		}
+	}
+	if (!any) return false;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		++p;
+		auto negative_exponent = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative_exponent = *p == '-';
+			++p;
+		}
+		auto e = 0;
+		for (; p < end && is_digit(*p); ++p) {
+			if (e < 10000) e = e * 10 + (*p - '0');
+		}
+		exponent += negative_exponent ? -e : e;
+	}
+
+	auto value = static_cast<double>(mantissa);
+	for (; exponent > 22; exponent -= 22) value *= 1e22;
+	for (; exponent < -22; exponent += 22) value /= 1e22;
+	value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+	out = static_cast<float>(negative ? -value : value);
+	return true;
+}
+
+static bool parse_int(const char *&p, const char *end, int &out) {
+	auto negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	if (p >= end || !is_digit(*p)) return false;
+	long long value = 0;
+	for (; p < end && is_digit(*p); ++p) {
+		if (value < (1LL << 31)) value = value * 10 + (*p - '0');
+	}
+	out = static_cast<int>(negative ? -value : value);
+	return true;
+}
+
+// turn a 1-based (or negative, relative) obj index into a 0-based one. count is how many of
+// that attribute this chunk has read so far. 0 means the index wasn't given
+static int resolve_index(int index, size_t count, bool &relative) {
+	relative = index < 0;
+	if (index > 0) return index - 1;
+	if (index < 0) return static_cast<int>(count) + index;
+	return -1;
+}
+
+// read up to n floats off the line into the given arrays, missing values are 0
+static void parse_floats(const char *&p, const char *end, std::vector<float> **dst, int n) {
+	for (auto i = 0; i < n; ++i) {
+		auto v = 0.0f;
+		parse_float(p, end, v);
+		dst[i]->push_back(v);
+	}
+}
+
+static void parse_chunk(const char *begin, const char *end, ObjChunk &chunk) {
+	auto &m = chunk.mesh;
+	std::vector<float> *positions[] = {&m.vx, &m.vy, &m.vz};
+	std::vector<float> *uvs[] = {&m.tu, &m.tv};
+	std::vector<float> *normals[] = {&m.nx, &m.ny, &m.nz};
+	// reused for every face so the loop doesn't allocate per line
+	std::vector<ObjCorner> polygon;
+
+	auto p = begin;
+	while (p < end) {
+		while (p < end && is_space(*p)) ++p;
+		auto line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+		if (!line_end) line_end = end;
+
+		if (line_end - p >= 2) {
+			// v 0.460214 0.163208 -0.055258
+			if (p[0] == 'v' && is_space(p[1])) {
+				p += 1;
+				parse_floats(p, line_end, positions, 3);
+			}
+			// vt  0.550 0.946 0.000
+			else if (p[0] == 'v' && p[1] == 't' && (line_end - p == 2 || is_space(p[2]))) {
+				p += 2;
+				parse_floats(p, line_end, uvs, 2);
+			}
+			// vn  -0.184 0.792 0.581
+			else if (p[0] == 'v' && p[1] == 'n' && (line_end - p == 2 || is_space(p[2]))) {
+				p += 2;
+				parse_floats(p, line_end, normals, 3);
+			}
+			// f 1106/1145/1106 1136/1182/1136 1132/1178/1132, or v, v/vt, v//vn, with any number of corners
+			else if (p[0] == 'f' && is_space(p[1])) {
+				p += 1;
+				polygon.clear();
+				auto valid = true;
+				for (;;) {
+					while (p < line_end && is_space(*p)) ++p;
+					int v = 0, vt = 0, vn = 0;
+					if (!parse_int(p, line_end, v)) break;
+					if (p < line_end && *p == '/') {
+						++p;
+						if (p < line_end && *p == '/') {
+							++p;
+							parse_int(p, line_end, vn);
+						} else {
+							parse_int(p, line_end, vt);
+							if (p < line_end && *p == '/') {
+								++p;
+								parse_int(p, line_end, vn);
+							}
+						}
+					}
+					ObjCorner corner;
+					corner.v = resolve_index(v, m.vx.size(), corner.relative_v);
+					corner.vt = resolve_index(vt, m.tu.size(), corner.relative_vt);
+					corner.vn = resolve_index(vn, m.nx.size(), corner.relative_vn);
+					if (v == 0) valid = false;
+					polygon.push_back(corner);
+					// skip anything we don't understand up to the next corner
+					while (p < line_end && !is_space(*p)) ++p;
+				}
+
+				// fan out polygons into triangles (0, i, i+1)
+				for (size_t i = 1; valid && i + 1 < polygon.size(); ++i) {
+					for (auto k : {size_t(0), i, i + 1}) {
+						auto &c = polygon[k];
+						if (c.relative_v) chunk.relative_v.push_back(m.vfaces.size());
+						if (c.relative_vt) chunk.relative_vt.push_back(m.vtfaces.size());
+						if (c.relative_vn) chunk.relative_vn.push_back(m.vnfaces.size());
+						m.vfaces.push_back(c.v);
+						m.vtfaces.push_back(c.vt);
+						m.vnfaces.push_back(c.vn);
+					}
+				}
+			}
+		}
+		p = line_end < end ? line_end + 1 : end;
+	}
+}
+
+template <class T>
+static void append(std::vector<T> &dst, const std::vector<T> &src) {
+	dst.insert(dst.end(), src.begin(), src.end());
+}
+
+// stitch the chunks together in file order, fixing up relative indices
+static void merge_chunks(std::vector<ObjChunk> &chunks, MeshData &mesh) {
+	if (chunks.size() == 1) {
+		mesh = std::move(chunks[0].mesh);
+		return;
+	}
+	size_t verts = 0, uvs = 0, normals = 0, indices = 0;
+	for (auto &c : chunks) {
+		verts += c.mesh.vx.size();
+		uvs += c.mesh.tu.size();
+		normals += c.mesh.nx.size();
+		indices += c.mesh.vfaces.size();
+	}
+	for (auto v : {&mesh.vx, &mesh.vy, &mesh.vz}) v->reserve(verts);
+	for (auto v : {&mesh.tu, &mesh.tv}) v->reserve(uvs);
+	for (auto v : {&mesh.nx, &mesh.ny, &mesh.nz}) v->reserve(normals);
+	for (auto v : {&mesh.vfaces, &mesh.vtfaces, &mesh.vnfaces}) v->reserve(indices);
+
+	for (auto &c : chunks) {
+		auto &m = c.mesh;
+		auto base_v = static_cast<int>(mesh.vx.size());
+		auto base_vt = static_cast<int>(mesh.tu.size());
+		auto base_vn = static_cast<int>(mesh.nx.size());
+		for (auto i : c.relative_v) m.vfaces[i] += base_v;
+		for (auto i : c.relative_vt) m.vtfaces[i] += base_vt;
+		for (auto i : c.relative_vn) m.vnfaces[i] += base_vn;
+		append(mesh.vx, m.vx);
+		append(mesh.vy, m.vy);
+		append(mesh.vz, m.vz);
+		append(mesh.tu, m.tu);
+		append(mesh.tv, m.tv);
+		append(mesh.nx, m.nx);
+		append(mesh.ny, m.ny);
+		append(mesh.nz, m.nz);
+		append(mesh.vfaces, m.vfaces);
+		append(mesh.vtfaces, m.vtfaces);
+		append(mesh.vnfaces, m.vnfaces);
+		m = MeshData();
+	}
+}
+
+// drop triangles that point past the end of the vertex arrays, rather than crash drawing them
+static size_t remove_bad_faces(MeshData &mesh) {
+	auto nv = static_cast<int>(mesh.vx.size());
+	auto nvt = static_cast<int>(mesh.tu.size());
+	auto nvn = static_cast<int>(mesh.nx.size());
+	size_t kept = 0;
+	for (size_t i = 0; i < mesh.vfaces.size(); i += 3) {
+		auto ok = true;
+		for (auto k = i; k < i + 3; ++k) {
+			ok = ok && mesh.vfaces[k] >= 0 && mesh.vfaces[k] < nv;
+			ok = ok && mesh.vtfaces[k] >= -1 && mesh.vtfaces[k] < nvt;
+			ok = ok && mesh.vnfaces[k] >= -1 && mesh.vnfaces[k] < nvn;
+		}
+		if (!ok) continue;
+		for (auto k = i; k < i + 3; ++k, ++kept) {
+			mesh.vfaces[kept] = mesh.vfaces[k];
+			mesh.vtfaces[kept] = mesh.vtfaces[k];
+			mesh.vnfaces[kept] = mesh.vnfaces[k];
+		}
+	}
+	auto removed = (mesh.vfaces.size() - kept) / 3;
+	mesh.vfaces.resize(kept);
+	mesh.vtfaces.resize(kept);
+	mesh.vnfaces.resize(kept);
+	return removed;
+}
+
+bool load_obj(const char *filename, MeshData &mesh, ThreadPool *pool) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(filename, true)) return false;
+
+	// cut the file at line boundaries
+	auto nchunks = 1;
+	if (pool && pool->size() > 1 && file.size() >= PARALLEL_MIN_BYTES) {
+		nchunks = pool->size() * CHUNKS_PER_THREAD;
+	}
+	std::vector<const char *> bounds(nchunks + 1);
+	bounds[0] = file.begin();
+	bounds[nchunks] = file.end();
+	for (auto i = 1; i < nchunks; ++i) {
+		auto p = std::max(bounds[i - 1], file.begin() + file.size() * i / nchunks);
+		auto newline = static_cast<const char *>(memchr(p, '\n', file.end() - p));
+		bounds[i] = newline ? newline + 1 : file.end();
+	}
+
+	std::vector<ObjChunk> chunks(nchunks);
+	auto parse = [&](int i) {
+		parse_chunk(bounds[i], bounds[i + 1], chunks[i]);
+	};
+	if (nchunks > 1) {
+		pool->parallel_for(nchunks, parse);
+	} else {
+		parse(0);
+	}
+	mesh = MeshData();
+	merge_chunks(chunks, mesh);
+
+	auto removed = remove_bad_faces(mesh);
+	if (removed) {
+		std::cerr << "dropped " << removed << " faces with out of range indices\n";
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	auto megabytes = file.size() / (1024.0 * 1024.0);
+	std::cerr << "# obj " << megabytes << " MB in " << seconds * 1000 << " ms, "
+		<< (seconds > 0 ? megabytes / seconds : 0) << " MB/s (" << nchunks << " chunks)\n";
+	return true;
+}
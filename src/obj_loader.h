@@ -0,0 +1,14 @@
+#ifndef __OBJ_LOADER_H__
+#define __OBJ_LOADER_H__
+
+#include "mesh.h"
+
+class ThreadPool;
+
+// read a wavefront .obj file into mesh. the file is memory-mapped and numbers are parsed by hand.
+// big files are cut into chunks at line boundaries and parsed on pool (if given), then stitched
+// back together in order. faces can be v, v/vt, v//vn or v/vt/vn with positive or negative
+// (relative) indices, and polygons with more than 3 corners are fan-triangulated
+bool load_obj(const char *filename, MeshData &mesh, ThreadPool *pool = nullptr);
+
+#endif //__OBJ_LOADER_H__
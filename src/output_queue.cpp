@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "output_queue.h"
+
+OutputQueue::OutputQueue(int buffers, int tile, ThreadPool *p) : max_buffers(std::max(2, buffers)), tile_size(tile), pool(p), writing(0), failed(false), stopping(false) {
+	writer = std::thread(&OutputQueue::writer_loop, this);
+}
+
+OutputQueue::~OutputQueue() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queued.notify_all();
+	writer.join();
+}
+
+void OutputQueue::writer_loop() {
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			queued.wait(lock, [&] { return stopping || !jobs.empty(); });
+			// drain the queue before stopping
+			if (jobs.empty()) return;
+			job = jobs.front();
+			jobs.pop_front();
+			++writing;
+		}
+
+		StageTimes t;
+		auto ok = true;
+		{
+			StageTimer timer(t, STAGE_ENCODE);
+			if (job.stream) {
+				job.stream->encode_frame(job.fb->get_image().buffer(), true);
+			} else {
+				file.clear();
+				ok = encode_image(job.format, job.fb->get_image(), file, true, pool);
+			}
+		}
+		if (ok) {
+			StageTimer timer(t, STAGE_WRITE);
+			ok = job.stream ? job.stream->write_encoded() : write_file(job.path.c_str(), file);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			times.add(t);
+			if (!ok) failed = true;
+			idle.push_back(job.fb);
+			--writing;
+		}
+		returned.notify_all();
+	}
+}
+
+Framebuffer &OutputQueue::acquire(int w, int h, DepthFormat format) {
+	Framebuffer *fb;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (idle.empty() && static_cast<int>(buffers.size()) < max_buffers) {
+			buffers.emplace_back(new Framebuffer(w, h, tile_size, format));
+			return *buffers.back();
+		}
+		returned.wait(lock, [&] { return !idle.empty(); });
+		fb = idle.back();
+		idle.pop_back();
+	}
+	fb->resize(w, h, format);
+	return *fb;
+}
+
+void OutputQueue::submit(Framebuffer &fb, const std::string &path, ImageFormat format) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(Job{&fb, path, format, nullptr});
+	}
+	queued.notify_one();
+}
+
+void OutputQueue::submit(Framebuffer &fb, FrameStream &stream) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(Job{&fb, std::string(), IMAGE_Y4M, &stream});
+	}
+	queued.notify_one();
+}
+
+bool OutputQueue::finish() {
+	std::unique_lock<std::mutex> lock(mutex);
+	returned.wait(lock, [&] { return jobs.empty() && writing == 0; });
+	return !failed;
+}
+
+StageTimes OutputQueue::write_times() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return times;
+}
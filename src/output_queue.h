@@ -0,0 +1,73 @@
+#ifndef __OUTPUT_QUEUE_H__
+#define __OUTPUT_QUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_stream.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "instrument.h"
+
+class ThreadPool;
+
+// writes finished frames out on a background thread while the next ones render. frames are
+// drawn into framebuffers borrowed from a small pool: acquire() one, draw, resolve, submit() it
+// with a path, and it goes back to the pool once its file is written. with every buffer either
+// drawing or waiting to be written acquire() blocks, which keeps the renderer from getting more
+// than buffers - 1 frames ahead of the disk.
+// tga files are rle encoded on pool (if given), taking turns with whatever the renderer runs on
+// it. every format is encoded bottom-up straight from the framebuffer, so nothing gets flipped
+class OutputQueue {
+private:
+	struct Job {
+		Framebuffer *fb;
+		std::string path;
+		ImageFormat format;
+		FrameStream *stream; // where the frame goes instead of path, if set
+	};
+
+	int max_buffers;
+	int tile_size;
+	ThreadPool *pool;
+	std::vector<std::unique_ptr<Framebuffer>> buffers; // made as they're first needed
+	std::vector<Framebuffer *> idle;
+	std::deque<Job> jobs;
+	int writing; // jobs taken off the queue and not yet written
+	bool failed;
+	bool stopping;
+	StageTimes times;
+	std::vector<unsigned char> file; // the frame being written, encoded. only the writer uses it
+	std::mutex mutex;
+	std::condition_variable queued;   // a job was submitted, or it's time to stop
+	std::condition_variable returned; // a buffer came back from the writer
+	std::thread writer;
+
+	void writer_loop();
+public:
+	// at most buffers framebuffers (2, double buffering, at the least), of tile size tiles
+	OutputQueue(int buffers, int tile, ThreadPool *pool = nullptr);
+	// writes whatever is still queued first
+	~OutputQueue();
+	OutputQueue(const OutputQueue &) = delete;
+	OutputQueue &operator=(const OutputQueue &) = delete;
+	// a w x h framebuffer to draw the next frame into, waiting for one to be written if none is free
+	Framebuffer &acquire(int w, int h, DepthFormat format);
+	// queue fb, resolved, to be written to path as format ("-" for stdout). fb mustn't be touched
+	// again until acquired again
+	void submit(Framebuffer &fb, const std::string &path, ImageFormat format = IMAGE_TGA);
+	// queue fb, resolved, as the next frame of stream. frames reach it in the order they're
+	// submitted, and the stream belongs to the writer until finish()
+	void submit(Framebuffer &fb, FrameStream &stream);
+	// wait for everything submitted so far to be written. false if any of it couldn't be
+	bool finish();
+	// the time spent on the writer thread so far, encoding frames under STAGE_ENCODE and writing
+	// them under STAGE_WRITE
+	StageTimes write_times();
+};
+
+#endif //__OUTPUT_QUEUE_H__
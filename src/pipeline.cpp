@@ -0,0 +1,79 @@
+#include <cstring>
+#include "pipeline.h"
+#include "vertex_stage.h"
+
+const char *shade_mode_name(ShadeMode mode) {
+	switch (mode) {
+		case SHADE_DEPTH: return "depth";
+		case SHADE_FLAT: return "flat";
+		case SHADE_GOURAUD: return "gouraud";
+		case SHADE_PHONG: return "phong";
+		case SHADE_TEXTURED: return "textured";
+		default: return "textured-phong";
+	}
+}
+
+ShadeMode parse_shade_mode(const char *name) {
+	for (auto mode : {SHADE_DEPTH, SHADE_FLAT, SHADE_GOURAUD, SHADE_PHONG, SHADE_TEXTURED}) {
+		if (!strcmp(name, shade_mode_name(mode))) return mode;
+	}
+	return SHADE_TEXTURED_PHONG;
+}
+
+void process_geometry(Model &m, const Camera &camera, int w, int h, ThreadPool &pool, const RasterOptions &options, std::vector<ScreenTriangle> &triangles, RenderStats &stats) {
+	ScreenVertices vertices;
+	{
+		StageTimer timer(stats.times, STAGE_VERTEX);
+		transform_vertices(options.isa, m.mesh(), camera.screen_matrix(w, h), w, h, vertices, &pool);
+	}
+	stats.vertices_transformed += m.nverts();
+	// done per face, every face would have transformed its own 3
+	stats.vertex_transforms_saved += 3LL * m.nfaces() - m.nverts();
+	StageTimer timer(stats.times, STAGE_ASSEMBLE);
+	assemble_triangles(m.mesh(), vertices, w, h, options.cull, triangles, stats, &pool);
+}
+
+// call draw with the shader for mode. each mode is its own instantiation of whatever draw does
+template <class F>
+static void with_shader(ShadeMode mode, const Texture &texture, Vec3f towards_light, F draw) {
+	switch (mode) {
+		case SHADE_DEPTH:
+			draw(DepthShader());
+			break;
+		case SHADE_FLAT:
+			draw(FlatShader(towards_light));
+			break;
+		case SHADE_GOURAUD:
+			draw(GouraudShader(towards_light));
+			break;
+		case SHADE_PHONG:
+			draw(PhongShader(towards_light));
+			break;
+		case SHADE_TEXTURED:
+			draw(TexturedShader(texture));
+			break;
+		case SHADE_TEXTURED_PHONG:
+			draw(TexturedPhongShader(texture, towards_light));
+			break;
+	}
+}
+
+void draw_scene(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	with_shader(mode, texture, towards_light, [&](const auto &shader) {
+		if (options.deferred) {
+			draw_model_deferred(m, camera, shader, fb, pool, options, stats);
+		} else {
+			draw_model(m, camera, shader, fb, pool, options, stats);
+		}
+	});
+}
+
+void draw_scene_triangles(ShadeMode mode, const std::vector<ScreenTriangle> &triangles, const Texture &texture, Vec3f towards_light, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	with_shader(mode, texture, towards_light, [&](const auto &shader) {
+		if (options.deferred) {
+			draw_triangles_deferred(triangles, shader, fb, pool, options, stats);
+		} else {
+			draw_triangles(triangles, shader, fb, pool, options, stats);
+		}
+	});
+}
@@ -0,0 +1,227 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <cstdint>
+#include <vector>
+#include "assembly.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "hiz.h"
+#include "model.h"
+#include "raster_simd.h"
+#include "shaders.h"
+#include "stats.h"
+#include "thread_pool.h"
+#include "tiles.h"
+
+// tiles are this many pixels square when drawing on more than one thread
+const int TILE_SIZE = 64;
+
+// how triangles get drawn
+struct RasterOptions {
+	RasterIsa isa; // pixel kernel
+	bool hiz;      // skip blocks hierarchical z says can't pass the depth test
+	bool deferred; // shade after all the depth testing is done, see draw_model_deferred
+	bool cull;     // drop back faces
+};
+
+// the geometry stages: transform every vertex of m for a width x height image once, up front,
+// then assemble faces from them into the triangles worth rasterizing
+void process_geometry(Model &m, const Camera &camera, int width, int height, ThreadPool &pool, const RasterOptions &options, std::vector<ScreenTriangle> &triangles, RenderStats &stats);
+
+// depth test every pixel of t inside clip, calling visible(x, y, weights) for the ones that pass
+template <class F>
+void rasterize_triangle(const ScreenTriangle &t, Framebuffer &fb, const Rect &clip, const RasterOptions &options, RenderStats &stats, F visible) {
+	auto z = Vec3f(t.a.z, t.b.z, t.c.z);
+	auto passed = [&](int x, int y, Vec3f weights) {
+		if (INSTRUMENTED) stats.pixels_passed++;
+		visible(x, y, weights);
+	};
+	// coverage, depth interpolation and the z test run several pixels at a time when the cpu allows,
+	// visible only runs for the pixels that made it past the z-buffer
+	if (options.hiz) {
+		rasterize_hiz(options.isa, t.setup, clip, z, fb, stats, passed);
+	} else {
+		if (!t.setup.bounds.intersect(clip).empty()) stats.triangles_rasterized++;
+		rasterize_depth_tested(options.isa, t.setup, clip, z, fb.depth_buffer(), fb.get_width(), fb.get_depth_format(), stats.pixels_tested, passed);
+	}
+}
+
+// count the pixels inside clip that something has been drawn on, when INSTRUMENTED
+inline void count_covered(Framebuffer &fb, const Rect &clip, RenderStats &stats) {
+	if (!INSTRUMENTED) return;
+	auto depth = fb.depth_buffer();
+	for (auto y = clip.y0; y < clip.y1; ++y) {
+		auto row = depth + static_cast<size_t>(y) * fb.get_width();
+		for (auto x = clip.x0; x < clip.x1; ++x) stats.pixels_covered += row[x] != 0;
+	}
+}
+
+// get shader ready for triangle t: per-triangle work, the vertex shader at each corner, and the
+// planes the varyings are interpolated with
+template <class S>
+void begin_shading(const ScreenTriangle &t, S &shader, VaryingPlanes<S::VARYINGS> &planes) {
+	float corners[3][VaryingPlanes<S::VARYINGS>::SIZE];
+	shader.begin(t);
+	for (auto k = 0; k < 3; ++k) shader.vertex(t, k, corners[k]);
+	planes.setup(t, corners);
+}
+
+// rasterize a triangle into the framebuffer, shading pixels as soon as they pass the depth test
+// only pixels inside clip are touched, so disjoint clip rects can be drawn from different threads.
+// t's setup is in framebuffer rows, its corners (and so its shading) in image rows
+template <class S>
+void draw_triangle(const ScreenTriangle &t, S &shader, Framebuffer &fb, const Rect &clip, const RasterOptions &options, RenderStats &stats) {
+	VaryingPlanes<S::VARYINGS> planes;
+	begin_shading(t, shader, planes);
+	auto origin_y = fb.get_origin_y();
+	rasterize_triangle(t, fb, clip, options, stats, [&](int x, int y, Vec3f) {
+		float v[VaryingPlanes<S::VARYINGS>::SIZE];
+		planes.at(x, y + origin_y, v);
+		fb.set(x, y, shader.fragment(planes, v));
+		if (INSTRUMENTED) stats.fragments_shaded++;
+	});
+}
+
+// draw triangles (from process_geometry) into a framebuffer
+// with a single thread the triangles are drawn one after another over the whole screen.
+// otherwise triangles are binned into TILE_SIZE tiles and the pool rasterizes whole tiles at a time;
+// every tile owns its pixels of color and depth (and clears them itself), and its own copy of
+// the shader, so no locking is needed and the result is bit-identical to the serial path.
+// counters and stage times are added into stats, shading being timed as part of rasterizing
+template <class S>
+void draw_triangles(const std::vector<ScreenTriangle> &triangles, const S &shader, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	auto w = fb.get_width();
+	auto h = fb.get_height();
+	StageTimer timer(stats.times, STAGE_RASTER);
+	auto shaded = stats.fragments_shaded;
+	auto screen = Rect(0, 0, w, h);
+	if (pool.size() == 1) {
+		auto s = shader;
+		fb.prepare(screen);
+		// for each triangle
+		for (auto &t : triangles) {
+			draw_triangle(t, s, fb, screen, options, stats);
+		}
+		count_covered(fb, screen, stats);
+		stats.texture_samples += (stats.fragments_shaded - shaded) * S::TEXTURE_SAMPLES;
+		return;
+	}
+
+	// bin every triangle into the tiles its bounding box touches
+	auto grid = TileGrid(w, h, TILE_SIZE);
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		grid.bin(static_cast<int>(i), triangles[i].setup.bounds);
+	}
+
+	// rasterize the tiles in parallel, each counting into its own stats
+	std::vector<RenderStats> tile_stats(grid.ntiles());
+	pool.parallel_for(grid.ntiles(), [&](int tile) {
+		auto s = shader;
+		auto clip = grid.tile_rect(tile);
+		fb.prepare(clip);
+		for (auto i : grid.get_bin(tile)) {
+			draw_triangle(triangles[i], s, fb, clip, options, tile_stats[tile]);
+		}
+		count_covered(fb, clip, tile_stats[tile]);
+	});
+	for (auto &s : tile_stats) stats.add(s);
+	stats.texture_samples += (stats.fragments_shaded - shaded) * S::TEXTURE_SAMPLES;
+}
+
+// draw a model into a framebuffer: its geometry, then draw_triangles
+template <class S>
+void draw_model(Model &m, const Camera &camera, const S &shader, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	std::vector<ScreenTriangle> triangles;
+	process_geometry(m, camera, fb.get_width(), fb.get_height(), pool, options, triangles, stats);
+	draw_triangles(triangles, shader, fb, pool, options, stats);
+}
+
+// no triangle covers this pixel
+const uint32_t NO_TRIANGLE = UINT32_MAX;
+
+// draw triangles into a framebuffer in two passes, so every pixel is shaded exactly once however
+// many triangles overlap it. the first pass only depth tests, leaving the index of the nearest
+// triangle in a visibility buffer; the second shades each pixel from the triangle it names,
+// setting the shader up again whenever that changes along a row.
+// each pass runs over all the tiles in parallel, and is timed as a stage of its own. the image
+// is identical to draw_triangles'
+template <class S>
+void draw_triangles_deferred(const std::vector<ScreenTriangle> &triangles, const S &shader, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	auto w = fb.get_width();
+	auto h = fb.get_height();
+	auto origin_y = fb.get_origin_y();
+
+	// bin every triangle into the tiles its bounding box touches
+	auto grid = TileGrid(w, h, TILE_SIZE);
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		grid.bin(static_cast<int>(i), triangles[i].setup.bounds);
+	}
+
+	std::vector<uint32_t> visibility(static_cast<size_t>(w) * h);
+	std::vector<RenderStats> tile_stats(grid.ntiles());
+
+	// pass 1: depth and visibility only
+	{
+		StageTimer timer(stats.times, STAGE_RASTER);
+		pool.parallel_for(grid.ntiles(), [&](int tile) {
+			auto clip = grid.tile_rect(tile);
+			fb.prepare(clip);
+			for (auto y = clip.y0; y < clip.y1; ++y) {
+				auto row = visibility.data() + static_cast<size_t>(y) * w;
+				std::fill(row + clip.x0, row + clip.x1, NO_TRIANGLE);
+			}
+			for (auto i : grid.get_bin(tile)) {
+				rasterize_triangle(triangles[i], fb, clip, options, tile_stats[tile], [&](int x, int y, Vec3f) {
+					visibility[x + static_cast<size_t>(y) * w] = i;
+				});
+			}
+		});
+	}
+
+	// pass 2: shade the pixel each triangle won
+	StageTimer timer(stats.times, STAGE_SHADE);
+	pool.parallel_for(grid.ntiles(), [&](int tile) {
+		auto clip = grid.tile_rect(tile);
+		auto s = shader;
+		VaryingPlanes<S::VARYINGS> planes;
+		auto current = NO_TRIANGLE;
+		long long shaded = 0;
+		for (auto y = clip.y0; y < clip.y1; ++y) {
+			auto row = visibility.data() + static_cast<size_t>(y) * w;
+			for (auto x = clip.x0; x < clip.x1; ++x) {
+				if (row[x] == NO_TRIANGLE) continue;
+				if (row[x] != current) {
+					current = row[x];
+					begin_shading(triangles[current], s, planes);
+				}
+				float v[VaryingPlanes<S::VARYINGS>::SIZE];
+				planes.at(x, y + origin_y, v);
+				fb.set(x, y, s.fragment(planes, v));
+				if (INSTRUMENTED) shaded++;
+			}
+		}
+		// every pixel shaded is one something was drawn on
+		tile_stats[tile].fragments_shaded += shaded;
+		tile_stats[tile].pixels_covered += shaded;
+		tile_stats[tile].texture_samples += shaded * S::TEXTURE_SAMPLES;
+	});
+	for (auto &s : tile_stats) stats.add(s);
+}
+
+// draw_model, but through draw_triangles_deferred
+template <class S>
+void draw_model_deferred(Model &m, const Camera &camera, const S &shader, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats) {
+	std::vector<ScreenTriangle> triangles;
+	process_geometry(m, camera, fb.get_width(), fb.get_height(), pool, options, triangles, stats);
+	draw_triangles_deferred(triangles, shader, fb, pool, options, stats);
+}
+
+// draw m with the shader for mode, lit from the direction towards_light (unit length).
+// each mode is its own instantiation of the pipeline above
+void draw_scene(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats);
+
+// the same, for triangles already through process_geometry, deferred or not as options say
+void draw_scene_triangles(ShadeMode mode, const std::vector<ScreenTriangle> &triangles, const Texture &texture, Vec3f towards_light, Framebuffer &fb, ThreadPool &pool, const RasterOptions &options, RenderStats &stats);
+
+#endif //__PIPELINE_H__
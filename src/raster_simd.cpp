@@ -0,0 +1,35 @@
+#include <cstring>
+#include "raster_simd.h"
+
+RasterIsa detect_raster_isa() {
+#ifdef RENDERER_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return RASTER_AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return RASTER_SSE41;
+#endif
+	return RASTER_SCALAR;
+}
+
+const char *raster_isa_name(RasterIsa isa) {
+	switch (isa) {
+		case RASTER_AVX2: return "avx2";
+		case RASTER_SSE41: return "sse4";
+		default: return "scalar";
+	}
+}
+
+RasterIsa parse_raster_isa(const char *name) {
+	auto best = detect_raster_isa();
+	if (!strcmp(name, "scalar")) return RASTER_SCALAR;
+	// never hand back a kernel the cpu can't run
+	if (!strcmp(name, "sse4") && best >= RASTER_SSE41) return RASTER_SSE41;
+	if (!strcmp(name, "avx2") && best >= RASTER_AVX2) return RASTER_AVX2;
+	return best;
+}
+
+bool known_raster_isa(const char *name) {
+	for (auto isa : {RASTER_SCALAR, RASTER_SSE41, RASTER_AVX2}) {
+		if (!strcmp(name, raster_isa_name(isa))) return true;
+	}
+	return false;
+}
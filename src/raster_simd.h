@@ -0,0 +1,240 @@
+#ifndef __RASTER_SIMD_H__
+#define __RASTER_SIMD_H__
+
+#include "rasterizer.h"
+#include "framebuffer.h"
+#include "instrument.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RENDERER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// which pixel kernel rasterize_depth_tested runs
+enum RasterIsa {
+	RASTER_SCALAR, // one pixel at a time
+	RASTER_SSE41,  // 4 pixels per step
+	RASTER_AVX2    // 8 pixels per step
+};
+
+// the widest kernel this cpu can run
+RasterIsa detect_raster_isa();
+const char *raster_isa_name(RasterIsa isa);
+// parse "scalar", "sse4" or "avx2", anything else gives the cpu's best
+RasterIsa parse_raster_isa(const char *name);
+// whether name is one of those three, whether or not this cpu can run it
+bool known_raster_isa(const char *name);
+
+// interpolate z = z.x * w0 + z.y * w1 + z.z * w2 across the triangle, in float, the same way for every kernel
+inline float interpolate_depth(Vec3f z, Vec3f weights) {
+	return z.x * weights.x + z.y * weights.y + z.z * weights.z;
+}
+
+// scalar kernel: walk covered pixels, keep the ones closer than zbuffer and shade them
+template <class F>
+void rasterize_depth_tested_scalar(const TriangleSetup &t, const Rect &clip, Vec3f z, uint32_t *zbuffer, int stride, DepthFormat format, long long &tested, F shade) {
+	rasterize(t, clip, [&](int x, int y, Vec3f weights) {
+		if (INSTRUMENTED) tested++;
+		auto depth = encode_depth(interpolate_depth(z, weights), format);
+		auto &stored = zbuffer[x + static_cast<size_t>(y) * stride];
+		if (stored < depth) {
+			stored = depth;
+			shade(x, y, weights);
+		}
+	});
+}
+
+#ifdef RENDERER_X86_SIMD
+
+// depth test and write a group of pixels whose coverage, weights and depth were computed in lanes.
+// shading only runs for the lanes that survive, one at a time
+template <class F>
+inline void resolve_lanes(int mask, int x, int y, uint32_t *zrow, const uint32_t *depth, const float *l0, const float *l1, const float *l2, F &shade) {
+	while (mask) {
+		auto i = __builtin_ctz(mask);
+		mask &= mask - 1;
+		zrow[x + i] = depth[i];
+		shade(x + i, y, Vec3f(l0[i], l1[i], l2[i]));
+	}
+}
+
+// encode_depth, 4 and 8 lanes at a time
+__attribute__((target("sse4.1")))
+inline __m128i encode_depth_sse41(__m128 z, DepthFormat format) {
+	z = _mm_max_ps(z, _mm_setzero_ps());
+	if (format == DEPTH_UNORM24) {
+		z = _mm_min_ps(z, _mm_set1_ps(1.0f));
+		return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(16777215.0f)), _mm_set1_ps(0.5f)));
+	}
+	return _mm_castps_si128(z);
+}
+
+__attribute__((target("avx2")))
+inline __m256i encode_depth_avx2(__m256 z, DepthFormat format) {
+	z = _mm256_max_ps(z, _mm256_setzero_ps());
+	if (format == DEPTH_UNORM24) {
+		z = _mm256_min_ps(z, _mm256_set1_ps(1.0f));
+		return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(16777215.0f)), _mm256_set1_ps(0.5f)));
+	}
+	return _mm256_castps_si256(z);
+}
+
+// 4 pixels per step: coverage from the 32 bit edge values, then depth interpolation and the z test
+template <class F>
+__attribute__((target("sse4.1")))
+void rasterize_depth_tested_sse41(const TriangleSetup &t, const Rect &clip, Vec3f z, uint32_t *zbuffer, int stride, DepthFormat format, long long &tested, F shade) {
+	auto r = t.bounds.intersect(clip);
+	if (r.empty()) return;
+
+	auto &e = t.edges;
+	const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i minus_one = _mm_set1_epi32(-1);
+	__m128i offset0 = _mm_mullo_epi32(_mm_set1_epi32(static_cast<int>(e[0].a)), lane);
+	__m128i offset1 = _mm_mullo_epi32(_mm_set1_epi32(static_cast<int>(e[1].a)), lane);
+	__m128i offset2 = _mm_mullo_epi32(_mm_set1_epi32(static_cast<int>(e[2].a)), lane);
+	__m128i step0 = _mm_set1_epi32(static_cast<int>(e[0].a * 4));
+	__m128i step1 = _mm_set1_epi32(static_cast<int>(e[1].a * 4));
+	__m128i step2 = _mm_set1_epi32(static_cast<int>(e[2].a * 4));
+	__m128i bias0 = _mm_set1_epi32(t.bias[0]);
+	__m128i bias1 = _mm_set1_epi32(t.bias[1]);
+	__m128i bias2 = _mm_set1_epi32(t.bias[2]);
+	__m128 inv_area = _mm_set1_ps(t.inv_area);
+	__m128 za = _mm_set1_ps(z.x);
+	__m128 zb = _mm_set1_ps(z.y);
+	__m128 zc = _mm_set1_ps(z.z);
+	alignas(16) uint32_t depth[4];
+	alignas(16) float l0[4], l1[4], l2[4];
+
+	for (auto y = r.y0; y < r.y1; ++y) {
+		__m128i w0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(e[0].a * r.x0 + e[0].b * y + e[0].c)), offset0);
+		__m128i w1 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(e[1].a * r.x0 + e[1].b * y + e[1].c)), offset1);
+		__m128i w2 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(e[2].a * r.x0 + e[2].b * y + e[2].c)), offset2);
+		auto zrow = zbuffer + static_cast<size_t>(y) * stride;
+		for (auto x = r.x0; x < r.x1; x += 4) {
+			auto n = r.x1 - x;
+			__m128i inside = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(w0, w1), w2), minus_one);
+			if (n < 4) inside = _mm_and_si128(inside, _mm_cmpgt_epi32(_mm_set1_epi32(n), lane));
+			if (!_mm_testz_si128(inside, inside)) {
+				if (INSTRUMENTED) tested += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(inside)));
+				__m128 b0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(w0, bias0)), inv_area);
+				__m128 b1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(w1, bias1)), inv_area);
+				__m128 b2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(w2, bias2)), inv_area);
+				__m128i d = encode_depth_sse41(_mm_add_ps(_mm_add_ps(_mm_mul_ps(za, b0), _mm_mul_ps(zb, b1)), _mm_mul_ps(zc, b2)), format);
+
+				// don't read past the end of the row
+				uint32_t partial[4] = {0, 0, 0, 0};
+				const uint32_t *src = zrow + x;
+				if (n < 4) {
+					for (auto i = 0; i < n; ++i) partial[i] = zrow[x + i];
+					src = partial;
+				}
+				// encoded depths are all below 2^31, so a signed compare is fine
+				__m128i stored = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+				auto mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(inside, _mm_cmpgt_epi32(d, stored))));
+				if (mask) {
+					_mm_store_si128(reinterpret_cast<__m128i *>(depth), d);
+					_mm_store_ps(l0, b0);
+					_mm_store_ps(l1, b1);
+					_mm_store_ps(l2, b2);
+					resolve_lanes(mask, x, y, zrow, depth, l0, l1, l2, shade);
+				}
+			}
+			w0 = _mm_add_epi32(w0, step0);
+			w1 = _mm_add_epi32(w1, step1);
+			w2 = _mm_add_epi32(w2, step2);
+		}
+	}
+}
+
+// 8 pixels per step, otherwise the same as the sse4.1 kernel
+template <class F>
+__attribute__((target("avx2")))
+void rasterize_depth_tested_avx2(const TriangleSetup &t, const Rect &clip, Vec3f z, uint32_t *zbuffer, int stride, DepthFormat format, long long &tested, F shade) {
+	auto r = t.bounds.intersect(clip);
+	if (r.empty()) return;
+
+	auto &e = t.edges;
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i minus_one = _mm256_set1_epi32(-1);
+	__m256i offset0 = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(e[0].a)), lane);
+	__m256i offset1 = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(e[1].a)), lane);
+	__m256i offset2 = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(e[2].a)), lane);
+	__m256i step0 = _mm256_set1_epi32(static_cast<int>(e[0].a * 8));
+	__m256i step1 = _mm256_set1_epi32(static_cast<int>(e[1].a * 8));
+	__m256i step2 = _mm256_set1_epi32(static_cast<int>(e[2].a * 8));
+	__m256i bias0 = _mm256_set1_epi32(t.bias[0]);
+	__m256i bias1 = _mm256_set1_epi32(t.bias[1]);
+	__m256i bias2 = _mm256_set1_epi32(t.bias[2]);
+	__m256 inv_area = _mm256_set1_ps(t.inv_area);
+	__m256 za = _mm256_set1_ps(z.x);
+	__m256 zb = _mm256_set1_ps(z.y);
+	__m256 zc = _mm256_set1_ps(z.z);
+	alignas(32) uint32_t depth[8];
+	alignas(32) float l0[8], l1[8], l2[8];
+
+	for (auto y = r.y0; y < r.y1; ++y) {
+		__m256i w0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(e[0].a * r.x0 + e[0].b * y + e[0].c)), offset0);
+		__m256i w1 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(e[1].a * r.x0 + e[1].b * y + e[1].c)), offset1);
+		__m256i w2 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(e[2].a * r.x0 + e[2].b * y + e[2].c)), offset2);
+		auto zrow = zbuffer + static_cast<size_t>(y) * stride;
+		for (auto x = r.x0; x < r.x1; x += 8) {
+			auto n = r.x1 - x;
+			__m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(w0, w1), w2), minus_one);
+			if (n < 8) inside = _mm256_and_si256(inside, _mm256_cmpgt_epi32(_mm256_set1_epi32(n), lane));
+			if (!_mm256_testz_si256(inside, inside)) {
+				if (INSTRUMENTED) tested += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(inside)));
+				__m256 b0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(w0, bias0)), inv_area);
+				__m256 b1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(w1, bias1)), inv_area);
+				__m256 b2 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(w2, bias2)), inv_area);
+				__m256i d = encode_depth_avx2(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(za, b0), _mm256_mul_ps(zb, b1)), _mm256_mul_ps(zc, b2)), format);
+
+				// don't read past the end of the row
+				uint32_t partial[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+				const uint32_t *src = zrow + x;
+				if (n < 8) {
+					for (auto i = 0; i < n; ++i) partial[i] = zrow[x + i];
+					src = partial;
+				}
+				// encoded depths are all below 2^31, so a signed compare is fine
+				__m256i stored = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+				auto mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(inside, _mm256_cmpgt_epi32(d, stored))));
+				if (mask) {
+					_mm256_store_si256(reinterpret_cast<__m256i *>(depth), d);
+					_mm256_store_ps(l0, b0);
+					_mm256_store_ps(l1, b1);
+					_mm256_store_ps(l2, b2);
+					resolve_lanes(mask, x, y, zrow, depth, l0, l1, l2, shade);
+				}
+			}
+			w0 = _mm256_add_epi32(w0, step0);
+			w1 = _mm256_add_epi32(w1, step1);
+			w2 = _mm256_add_epi32(w2, step2);
+		}
+	}
+}
+
+#endif //RENDERER_X86_SIMD
+
+// rasterize the triangle into zbuffer (a row-major buffer of encoded depths, stride values wide),
+// depth testing every covered pixel and calling shade(x, y, weights) for the ones that pass. z
+// holds the depth of each vertex, in [0, 1] with 1 nearest. every kernel produces exactly the same
+// depths and weights, triangles too big for 32 bit edge values always take the scalar path.
+// covered pixels are counted into tested when INSTRUMENTED
+template <class F>
+void rasterize_depth_tested(RasterIsa isa, const TriangleSetup &t, const Rect &clip, Vec3f z, uint32_t *zbuffer, int stride, DepthFormat format, long long &tested, F shade) {
+#ifdef RENDERER_X86_SIMD
+	if (t.fits_int32) {
+		if (isa == RASTER_AVX2) {
+			rasterize_depth_tested_avx2(t, clip, z, zbuffer, stride, format, tested, shade);
+			return;
+		}
+		if (isa == RASTER_SSE41) {
+			rasterize_depth_tested_sse41(t, clip, z, zbuffer, stride, format, tested, shade);
+			return;
+		}
+	}
+#endif
+	rasterize_depth_tested_scalar(t, clip, z, zbuffer, stride, format, tested, shade);
+}
+
+#endif //__RASTER_SIMD_H__
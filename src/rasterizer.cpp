@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+#include "rasterizer.h"
+
+// the widest SIMD group the kernels step across a row
+static const int MAX_LANES = 8;
+
+// floating point screen coordinate to fixed point
+static long long to_fixed(float v) {
+	return std::llround(double(v) * SUBPIXEL_ONE);
+}
+
+bool setup_triangle(Vec3f a, Vec3f b, Vec3f c, TriangleSetup &t) {
+	long long xs[3] = {to_fixed(a.x), to_fixed(b.x), to_fixed(c.x)};
+	long long ys[3] = {to_fixed(a.y), to_fixed(b.y), to_fixed(c.y)};
+
+	// twice the signed area, positive when a b c wind counter-clockwise
+	auto area = (xs[1] - xs[0]) * (ys[2] - ys[0]) - (ys[1] - ys[0]) * (xs[2] - xs[0]);
+	if (area == 0) return false;
+	// flip clockwise triangles over so the inside is always positive
+	auto sign = area > 0 ? 1 : -1;
+	t.counter_clockwise = area > 0;
+
+	for (auto i = 0; i < 3; ++i) {
+		// edge i runs from vertex s to vertex e, opposite vertex i
+		auto s = (i + 1) % 3;
+		auto e = (i + 2) % 3;
+		auto dx = (xs[e] - xs[s]) * sign;
+		auto dy = (ys[e] - ys[s]) * sign;
+
+		// E(p) = dx * (p.y - s.y) - dy * (p.x - s.x), with p at fixed point pixel positions
+		auto &edge = t.edges[i];
+		edge.a = -dy * SUBPIXEL_ONE;
+		edge.b = dx * SUBPIXEL_ONE;
+		edge.c = dy * xs[s] - dx * ys[s];
+
+		// top-left fill rule: the inside is on the left of the edge's direction, so a top edge
+		// runs towards -x and a left edge runs towards -y. anything else doesn't own its pixels
+		auto top_left = dy < 0 || (dy == 0 && dx < 0);
+		t.bias[i] = top_left ? 0 : 1;
+		edge.c -= t.bias[i];
+	}
+	t.inv_area = float(1.0 / double(area * sign));
+
+	// integral bounding box of the snapped vertices. pixel positions inside the triangle
+	// lie between ceil(min) and floor(max)
+	auto x_min = *std::min_element(xs, xs + 3);
+	auto x_max = *std::max_element(xs, xs + 3);
+	auto y_min = *std::min_element(ys, ys + 3);
+	auto y_max = *std::max_element(ys, ys + 3);
+	t.bounds = Rect(
+		static_cast<int>((x_min + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS),
+		static_cast<int>((y_min + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS),
+		static_cast<int>((x_max >> SUBPIXEL_BITS) + 1),
+		static_cast<int>((y_max >> SUBPIXEL_BITS) + 1)
+	);
+
+	// the SIMD kernels step edge values in 32 bit lanes. edge functions are linear, so
+	// checking the corners of the (slightly widened) bounding box covers every pixel in it
+	t.fits_int32 = true;
+	const long long limit = (1LL << 31) - 2;
+	int corner_x[2] = {t.bounds.x0, t.bounds.x1 + MAX_LANES};
+	int corner_y[2] = {t.bounds.y0, t.bounds.y1};
+	for (auto &edge : t.edges) {
+		for (auto cx : corner_x) {
+			for (auto cy : corner_y) {
+				auto v = edge.a * cx + edge.b * cy + edge.c;
+				if (v > limit || v < -limit) t.fits_int32 = false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#ifndef __RASTERIZER_H__
+#define __RASTERIZER_H__
+
+#include "geometry.h"
+#include "tiles.h"
+
+// screen positions are snapped to a 1/16th pixel grid before rasterizing
+const int SUBPIXEL_BITS = 4;
+const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// E(x, y) = a*x + b*y + c, evaluated at integral pixel positions (x, y).
+// E is positive on the inside of the edge
+struct EdgeFunction {
+	long long a, b, c;
+};
+
+// everything the inner loop needs to know about a triangle, worked out once up front
+struct TriangleSetup {
+	EdgeFunction edges[3];  // edge i is opposite vertex i, so E_i / area is vertex i's barycentric weight
+	int bias[3];            // 1 for edges that aren't top or left, already subtracted from edges[i].c
+	Rect bounds;            // pixels that might be covered
+	float inv_area;         // 1 / (twice the triangle's area), in fixed point units
+	bool fits_int32;        // every edge value in bounds (plus a SIMD group of slack) fits in 32 bits
+	bool counter_clockwise; // how a b c wound on screen, before edges were flipped to make the inside positive
+};
+
+// snap the screen-space triangle a b c to the sub-pixel grid and build its edge functions.
+// either winding is accepted. returns false if the triangle has no area
+bool setup_triangle(Vec3f a, Vec3f b, Vec3f c, TriangleSetup &t);
+
+// call fragment(x, y, weights) for every pixel inside both the triangle and clip, where weights
+// are the barycentric weights of a b c. the edge functions are stepped by constant increments, and
+// pixels sitting exactly on an edge belong to it only if it's a top or left edge, so triangles
+// sharing an edge never both draw (or both skip) a pixel on it
+template <class F>
+void rasterize(const TriangleSetup &t, const Rect &clip, F fragment) {
+	auto r = t.bounds.intersect(clip);
+	if (r.empty()) return;
+
+	auto &e0 = t.edges[0];
+	auto &e1 = t.edges[1];
+	auto &e2 = t.edges[2];
+	// edge values at the start of the first row
+	auto row0 = e0.a * r.x0 + e0.b * r.y0 + e0.c;
+	auto row1 = e1.a * r.x0 + e1.b * r.y0 + e1.c;
+	auto row2 = e2.a * r.x0 + e2.b * r.y0 + e2.c;
+
+	for (auto y = r.y0; y < r.y1; ++y) {
+		auto w0 = row0;
+		auto w1 = row1;
+		auto w2 = row2;
+		for (auto x = r.x0; x < r.x1; ++x) {
+			// inside if no edge value is negative
+			if ((w0 | w1 | w2) >= 0) {
+				fragment(x, y, Vec3f(
+					float(w0 + t.bias[0]) * t.inv_area,
+					float(w1 + t.bias[1]) * t.inv_area,
+					float(w2 + t.bias[2]) * t.inv_area
+				));
+			}
+			w0 += e0.a;
+			w1 += e1.a;
+			w2 += e2.a;
+		}
+		row0 += e0.b;
+		row1 += e1.b;
+		row2 += e2.b;
+	}
+}
+
+#endif //__RASTERIZER_H__
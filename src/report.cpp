@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "report.h"
+
+std::string json_string(const std::string &s) {
+	std::string out = "\"";
+	for (auto c : s) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out += escaped;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+// v, or null if it wasn't measured
+template <class T>
+static std::string measured(T v) {
+	return INSTRUMENTED ? std::to_string(v) : "null";
+}
+
+void write_report(std::ostream &out, const ReportSettings &settings, const RenderStats &stats) {
+	auto &r = stats;
+	out << "{\n";
+	out << "  \"instrumented\": " << (INSTRUMENTED ? "true" : "false") << ",\n";
+
+	out << "  \"settings\": {\n";
+	out << "    \"model\": " << json_string(settings.model) << ",\n";
+	out << "    \"width\": " << settings.width << ",\n";
+	out << "    \"height\": " << settings.height << ",\n";
+	out << "    \"threads\": " << settings.threads << ",\n";
+	out << "    \"raster\": " << json_string(settings.raster) << ",\n";
+	out << "    \"depth\": " << json_string(settings.depth) << ",\n";
+	out << "    \"shade\": " << json_string(settings.shade) << ",\n";
+	out << "    \"filter\": " << json_string(settings.filter) << ",\n";
+	out << "    \"wrap\": " << json_string(settings.wrap) << ",\n";
+	out << "    \"hiz\": " << (settings.hiz ? "true" : "false") << ",\n";
+	out << "    \"deferred\": " << (settings.deferred ? "true" : "false") << ",\n";
+	out << "    \"cull\": " << (settings.cull ? "true" : "false") << ",\n";
+	out << "    \"band_rows\": " << settings.band_rows << ",\n";
+	out << "    \"frames\": " << settings.frames << "\n";
+	out << "  },\n";
+
+	out << "  \"stages_ms\": {\n";
+	for (auto i = 0; i < STAGE_COUNT; ++i) {
+		out << "    " << json_string(stage_name(Stage(i))) << ": " << measured(r.times.seconds[i] * 1000) << ",\n";
+	}
+	out << "    \"total\": " << measured(r.times.total() * 1000) << "\n";
+	out << "  },\n";
+
+	out << "  \"counters\": {\n";
+	out << "    \"vertices_transformed\": " << r.vertices_transformed << ",\n";
+	out << "    \"vertex_transforms_saved\": " << r.vertex_transforms_saved << ",\n";
+	out << "    \"triangles_submitted\": " << r.faces_in << ",\n";
+	out << "    \"triangles_outside\": " << r.faces_outside << ",\n";
+	out << "    \"triangles_clipped\": " << r.faces_clipped << ",\n";
+	out << "    \"triangles_back_facing\": " << r.triangles_back_facing << ",\n";
+	out << "    \"triangles_empty\": " << r.triangles_empty << ",\n";
+	out << "    \"triangles_culled\": " << r.faces_outside + r.triangles_back_facing + r.triangles_empty << ",\n";
+	out << "    \"triangles_assembled\": " << r.triangles_assembled << ",\n";
+	out << "    \"triangles_rasterized\": " << r.triangles_rasterized << ",\n";
+	out << "    \"triangles_hiz_culled\": " << r.triangles_hiz_culled << ",\n";
+	out << "    \"blocks_tested\": " << r.blocks_tested << ",\n";
+	out << "    \"blocks_hiz_culled\": " << r.blocks_hiz_culled << ",\n";
+	out << "    \"pixels_tested\": " << measured(r.pixels_tested) << ",\n";
+	out << "    \"z_passes\": " << measured(r.pixels_passed) << ",\n";
+	out << "    \"z_fails\": " << measured(r.pixels_tested - r.pixels_passed) << ",\n";
+	out << "    \"pixels_covered\": " << measured(r.pixels_covered) << ",\n";
+	out << "    \"overdraw\": " << measured(r.overdraw()) << ",\n";
+	out << "    \"fragments_shaded\": " << measured(r.fragments_shaded) << ",\n";
+	out << "    \"texture_samples\": " << measured(r.texture_samples) << "\n";
+	out << "  },\n";
+
+	out << "  \"memory\": {\n";
+	out << "    \"peak_heap_bytes\": " << measured(heap_peak()) << "\n";
+	out << "  }\n";
+	out << "}\n";
+}
+
+bool write_report(const char *path, const ReportSettings &settings, const RenderStats &stats) {
+	if (std::string(path) == "-") {
+		write_report(std::cout, settings, stats);
+		return bool(std::cout.flush());
+	}
+	std::ofstream out(path);
+	if (out) write_report(out, settings, stats);
+	if (!out) {
+		std::cerr << "can't write the report to " << path << "\n";
+		return false;
+	}
+	return true;
+}
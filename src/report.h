@@ -0,0 +1,33 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+#include <ostream>
+#include <string>
+#include "stats.h"
+
+// what a frame was rendered with, to go alongside its numbers
+struct ReportSettings {
+	std::string model;
+	int width, height;
+	int threads;
+	const char *raster;
+	const char *depth;
+	const char *shade;
+	const char *filter;
+	const char *wrap;
+	bool hiz, deferred, cull;
+	int band_rows; // 0 when drawn whole
+	int frames;    // how many frames the numbers are the sum of
+};
+
+// s as a json string literal, quoted and escaped
+std::string json_string(const std::string &s);
+
+// write a frame's settings, stage times, counters and peak heap use as one json object, so runs
+// from different builds can be collected and compared by machine. stage times are in
+// milliseconds; everything only measured when INSTRUMENTED is null without it
+void write_report(std::ostream &out, const ReportSettings &settings, const RenderStats &stats);
+// the same into the file at path, or to stdout for "-". false (and a message) if it can't be written
+bool write_report(const char *path, const ReportSettings &settings, const RenderStats &stats);
+
+#endif //__REPORT_H__
@@ -0,0 +1,483 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "asset_cache.h"
+#include "camera.h"
+#include "report.h"
+#include "server.h"
+#include "util.h"
+
+// a value from a job message. messages are flat: strings, numbers, booleans, null, and arrays
+// of numbers, which is all a job needs
+struct JsonValue {
+	enum Kind {NUL, BOOL, NUMBER, STRING, NUMBERS} kind;
+	bool flag;
+	double number;
+	std::string text;
+	std::vector<double> numbers;
+	std::string source; // as it was written, to echo ids back
+};
+
+// a small parser for one flat json object, keys to values. false (and what's wrong in error)
+// for anything else
+class JsonReader {
+private:
+	const std::string &s;
+	size_t i;
+
+	void space() {
+		while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+	}
+	bool literal(const char *word) {
+		auto n = strlen(word);
+		if (s.compare(i, n, word)) return false;
+		i += n;
+		return true;
+	}
+	bool string(std::string &out) {
+		if (i >= s.size() || s[i] != '"') return false;
+		for (++i; i < s.size(); ++i) {
+			auto c = s[i];
+			if (c == '"') {
+				++i;
+				return true;
+			}
+			if (c != '\\') {
+				out += c;
+				continue;
+			}
+			if (++i >= s.size()) return false;
+			switch (s[i]) {
+				case 'n': out += '\n'; break;
+				case 't': out += '\t'; break;
+				case 'r': out += '\r'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'u': {
+					// only as far as latin 1, paths and names don't need more
+					unsigned code;
+					if (i + 4 >= s.size() || sscanf(s.c_str() + i + 1, "%4x", &code) != 1 || code > 0xff) return false;
+					out += static_cast<char>(code);
+					i += 4;
+					break;
+				}
+				default: out += s[i]; break;
+			}
+		}
+		return false;
+	}
+	bool number(double &out) {
+		auto start = s.c_str() + i;
+		char *end;
+		out = strtod(start, &end);
+		if (end == start || !std::isfinite(out)) return false;
+		i += end - start;
+		return true;
+	}
+	bool value(JsonValue &v) {
+		auto start = i;
+		if (i >= s.size()) return false;
+		auto c = s[i];
+		auto ok = true;
+		if (c == '"') {
+			v.kind = JsonValue::STRING;
+			ok = string(v.text);
+		} else if (c == '[') {
+			v.kind = JsonValue::NUMBERS;
+			++i;
+			space();
+			if (i < s.size() && s[i] == ']') {
+				++i;
+			} else {
+				for (;;) {
+					double x;
+					space();
+					if (!number(x)) return false;
+					v.numbers.push_back(x);
+					space();
+					if (i < s.size() && s[i] == ',') {
+						++i;
+					} else if (i < s.size() && s[i] == ']') {
+						++i;
+						break;
+					} else {
+						return false;
+					}
+				}
+			}
+		} else if (literal("true") || literal("false")) {
+			v.kind = JsonValue::BOOL;
+			v.flag = c == 't';
+		} else if (literal("null")) {
+			v.kind = JsonValue::NUL;
+		} else {
+			v.kind = JsonValue::NUMBER;
+			ok = number(v.number);
+		}
+		v.source = s.substr(start, i - start);
+		return ok;
+	}
+public:
+	explicit JsonReader(const std::string &text) : s(text), i(0) {
+	}
+	bool object(std::map<std::string, JsonValue> &out, std::string &error) {
+		space();
+		if (i >= s.size() || s[i] != '{') {
+			error = "a job has to be a json object";
+			return false;
+		}
+		++i;
+		space();
+		if (i < s.size() && s[i] == '}') {
+			++i;
+		} else {
+			for (;;) {
+				std::string key;
+				JsonValue v;
+				space();
+				if (!string(key)) {
+					error = "expected a key at " + std::to_string(i);
+					return false;
+				}
+				space();
+				if (i >= s.size() || s[i] != ':') {
+					error = "expected : at " + std::to_string(i);
+					return false;
+				}
+				++i;
+				space();
+				if (!value(v)) {
+					error = "can't read the value of " + key + " (only strings, numbers, booleans and arrays of numbers)";
+					return false;
+				}
+				out[key] = v;
+				space();
+				if (i < s.size() && s[i] == ',') {
+					++i;
+				} else if (i < s.size() && s[i] == '}') {
+					++i;
+					break;
+				} else {
+					error = "expected , or } at " + std::to_string(i);
+					return false;
+				}
+			}
+		}
+		space();
+		if (i != s.size()) {
+			error = "something after the object at " + std::to_string(i);
+			return false;
+		}
+		return true;
+	}
+};
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// what's shared by every connection, and what each keeps for itself between its jobs
+struct Server {
+	RenderJob defaults;
+	RasterOptions options;
+	long long max_pixels; // the most width x height a job can ask for
+	ThreadPool &pool;
+	AssetCache cache;
+	int listener; // -1 on stdin
+	std::atomic<bool> stopping;
+	std::mutex mutex;                // guards connections
+	std::set<int> connections;       // the sockets of connections still being served
+	std::condition_variable closed;  // signalled as each connection's thread ends
+
+	Server(const RenderJob &d, const RasterOptions &o, long long m, size_t cache_bytes, ThreadPool &p) : defaults(d), options(o), max_pixels(m), pool(p), cache(cache_bytes, &p), listener(-1), stopping(false) {
+	}
+};
+
+struct Session {
+	std::unique_ptr<Framebuffer> fb; // made for the first job, resized for the rest
+	bool done;
+	Session() : done(false) {
+	}
+};
+
+// stop taking connections, and stop reading from the open ones so idle clients can't keep the
+// server up. what they've already sent still gets answered
+static void stop(Server &server) {
+	std::lock_guard<std::mutex> lock(server.mutex);
+	server.stopping = true;
+	if (server.listener >= 0) shutdown(server.listener, SHUT_RDWR);
+	for (auto fd : server.connections) shutdown(fd, SHUT_RD);
+}
+
+// override job's settings with whatever the message has. false (and error) for a setting that
+// has the wrong kind of value
+static bool read_job(const std::map<std::string, JsonValue> &message, long long max_pixels, RenderJob &job, std::string &error) {
+	for (auto &kv : message) {
+		auto &key = kv.first;
+		auto &v = kv.second;
+		auto text = v.kind == JsonValue::STRING;
+		auto number = v.kind == JsonValue::NUMBER;
+		auto vector = v.kind == JsonValue::NUMBERS && v.numbers.size() == 3;
+		auto ok = true;
+		if (key == "id") {
+			continue;
+		} else if (key == "model") {
+			if ((ok = text)) job.model = v.text;
+		} else if (key == "texture") {
+			if ((ok = text)) job.texture = v.text;
+		} else if (key == "output") {
+			if ((ok = text)) job.output = v.text;
+		} else if (key == "format") {
+			if ((ok = text && known_name(v.text, parse_image_format, image_format_name))) job.format = v.text;
+		} else if (key == "width") {
+			if ((ok = number && v.number >= 1 && v.number <= 65535)) job.width = static_cast<int>(v.number);
+		} else if (key == "height") {
+			if ((ok = number && v.number >= 1 && v.number <= 65535)) job.height = static_cast<int>(v.number);
+		} else if (key == "eye" || key == "look_at" || key == "light") {
+			if ((ok = vector)) {
+				auto &p = key == "eye" ? job.eye : key == "look_at" ? job.target : job.light;
+				p = Vec3f(float(v.numbers[0]), float(v.numbers[1]), float(v.numbers[2]));
+			}
+		} else if (key == "fov") {
+			if ((ok = number && Camera::valid_fov(float(v.number)))) job.fov = float(v.number);
+		} else if (key == "ortho") {
+			if ((ok = number && v.number > 0)) job.ortho = float(v.number);
+		} else if (key == "near") {
+			if ((ok = number && v.number > 0)) job.near = float(v.number);
+		} else if (key == "far") {
+			if ((ok = number && v.number > 0)) job.far = float(v.number);
+		} else if (key == "shade") {
+			if ((ok = text && known_name(v.text, parse_shade_mode, shade_mode_name))) job.shade = parse_shade_mode(v.text.c_str());
+		} else if (key == "filter") {
+			if ((ok = text && known_name(v.text, parse_texture_filter, texture_filter_name))) job.filter = parse_texture_filter(v.text.c_str());
+		} else if (key == "wrap") {
+			if ((ok = text && known_name(v.text, parse_texture_wrap, texture_wrap_name))) job.wrap = parse_texture_wrap(v.text.c_str());
+		} else if (key == "depth") {
+			if ((ok = text && known_name(v.text, parse_depth_format, depth_format_name))) job.depth = parse_depth_format(v.text.c_str());
+		} else {
+			error = "unknown setting " + key;
+			return false;
+		}
+		if (!ok) {
+			error = "bad value for " + key;
+			return false;
+		}
+	}
+	if (job.output.empty() || job.output == "-") {
+		error = "a job needs an output file";
+		return false;
+	}
+	if (static_cast<long long>(job.width) * job.height > max_pixels) {
+		error = "width x height is over the " + std::to_string(max_pixels) + " pixels this server draws";
+		return false;
+	}
+	if (!Camera::valid_view(job.eye, job.target)) {
+		error = "bad value for look_at: it has to be some finite way from the eye";
+		return false;
+	}
+	if (!(job.far > job.near)) {
+		error = "far has to be beyond near";
+		return false;
+	}
+	if (job.light.norm() == 0) {
+		error = "the light can't be at the origin";
+		return false;
+	}
+	return true;
+}
+
+// answer one message, id being what to echo its id back with
+static std::string answer(Server &server, Session &session, std::map<std::string, JsonValue> &message, const std::string &id) {
+	auto start = std::chrono::steady_clock::now();
+	std::string error;
+	auto fail = [&](const std::string &what) {
+		return "{" + id + "\"ok\": false, \"error\": " + json_string(what) + "}";
+	};
+
+	if (message.count("command")) {
+		auto command = message["command"].text;
+		if (command == "shutdown") {
+			session.done = true;
+			stop(server);
+			return "{" + id + "\"ok\": true}";
+		}
+		if (command == "stats") {
+			std::ostringstream out;
+			out << "{" << id << "\"ok\": true, \"cached_assets\": " << server.cache.count() << ", \"cached_bytes\": " << server.cache.size()
+				<< ", \"hits\": " << server.cache.hits() << ", \"misses\": " << server.cache.misses() << "}";
+			return out.str();
+		}
+		return fail("unknown command " + command);
+	}
+
+	auto job = server.defaults;
+	if (!read_job(message, server.max_pixels, job, error)) return fail(error);
+
+	// the assets, from the cache if they're in it
+	bool model_hit, texture_hit;
+	auto model = server.cache.model(job.model, model_hit);
+	if (!model) return fail("can't load the model " + job.model);
+	auto texture = server.cache.texture(job.texture, job.filter, job.wrap, texture_hit);
+	if (!texture) return fail("can't load the texture " + job.texture);
+	auto load_ms = milliseconds_since(start);
+
+	// draw, as main does
+	auto draw_start = std::chrono::steady_clock::now();
+	Camera camera;
+	camera.look_at(job.eye, job.target);
+	if (job.ortho > 0) {
+		camera.set_orthographic(job.ortho, job.near, job.far);
+	} else if (job.fov > 0) {
+		camera.set_perspective(job.fov, job.near, job.far);
+	} else {
+		camera.set_clip_planes(job.near, job.far);
+	}
+	if (!session.fb) {
+		session.fb.reset(new Framebuffer(job.width, job.height, TILE_SIZE, job.depth));
+	} else {
+		session.fb->resize(job.width, job.height, job.depth);
+	}
+	auto &fb = *session.fb;
+	RenderStats stats;
+	fb.clear(job.background);
+	draw_scene(job.shade, *model, camera, *texture, job.light.normalize(), fb, server.pool, server.options, stats);
+	fb.resolve();
+	auto draw_ms = milliseconds_since(draw_start);
+
+	auto write_start = std::chrono::steady_clock::now();
+	auto format = job.format.empty() ? image_format_for_path(job.output) : parse_image_format(job.format.c_str());
+	if (!write_image(job.output.c_str(), format, fb.get_image(), true, &server.pool)) return fail("can't write " + job.output);
+	auto write_ms = milliseconds_since(write_start);
+
+	std::ostringstream out;
+	out << "{" << id << "\"ok\": true, \"output\": " << json_string(job.output) << ", \"format\": \"" << image_format_name(format) << "\", \"ms\": " << milliseconds_since(start)
+		<< ", \"load_ms\": " << load_ms << ", \"draw_ms\": " << draw_ms << ", \"write_ms\": " << write_ms
+		<< ", \"model_cached\": " << (model_hit ? "true" : "false") << ", \"texture_cached\": " << (texture_hit ? "true" : "false") << "}";
+	return out.str();
+}
+
+// answer one line of input. a job that throws (running out of memory, most likely) fails on its
+// own without taking the server down
+static std::string handle(Server &server, Session &session, const std::string &line) {
+	std::map<std::string, JsonValue> message;
+	std::string error;
+	std::string id;
+	auto fail = [&](const std::string &what) {
+		return "{" + id + "\"ok\": false, \"error\": " + json_string(what) + "}";
+	};
+	if (!JsonReader(line).object(message, error)) return fail(error);
+	if (message.count("id")) id = "\"id\": " + message["id"].source + ", ";
+	try {
+		return answer(server, session, message, id);
+	} catch (const std::exception &e) {
+		// the framebuffer may be half resized
+		session.fb.reset();
+		return fail(std::string("the job failed: ") + e.what());
+	}
+}
+
+// answer every line on one connection until it closes or asks the server to stop
+static void serve_connection(Server &server, int fd) {
+	Session session;
+	std::string pending;
+	char buffer[4096];
+	while (!session.done) {
+		auto n = recv(fd, buffer, sizeof(buffer), 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		pending.append(buffer, n);
+		size_t newline;
+		while (!session.done && (newline = pending.find('\n')) != std::string::npos) {
+			auto line = pending.substr(0, newline);
+			pending.erase(0, newline + 1);
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+			auto reply = handle(server, session, line) + "\n";
+			if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(reply.size())) {
+				session.done = true;
+			}
+		}
+	}
+	std::unique_lock<std::mutex> lock(server.mutex);
+	server.connections.erase(fd);
+	close(fd);
+	// serve waits for this before the server goes away, so only once the thread is all done
+	std::notify_all_at_thread_exit(server.closed, std::move(lock));
+}
+
+bool serve(const char *socket_path, const RenderJob &defaults, const RasterOptions &options, long long max_pixels, size_t cache_bytes, ThreadPool &pool) {
+	Server server(defaults, options, max_pixels, cache_bytes, pool);
+
+	if (!socket_path || !strcmp(socket_path, "-")) {
+		Session session;
+		std::string line;
+		while (!session.done && std::getline(std::cin, line)) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+			std::cout << handle(server, session, line) << std::endl;
+		}
+		return true;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		std::cerr << "socket path " << socket_path << " is too long\n";
+		return false;
+	}
+	strcpy(address.sun_path, socket_path);
+	// a socket left behind by a server that didn't get to clean up can go, anything else there stays
+	struct stat st;
+	if (lstat(socket_path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			std::cerr << "can't listen on " << socket_path << ": something that isn't a socket is there\n";
+			return false;
+		}
+		unlink(socket_path);
+	}
+	server.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server.listener < 0 || bind(server.listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server.listener, 16) != 0) {
+		std::cerr << "can't listen on " << socket_path << ": " << strerror(errno) << "\n";
+		if (server.listener >= 0) close(server.listener);
+		return false;
+	}
+	std::cerr << "# serving on " << socket_path << "\n";
+
+	for (;;) {
+		auto fd = accept(server.listener, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR && !server.stopping) continue;
+			break;
+		}
+		{
+			std::lock_guard<std::mutex> lock(server.mutex);
+			// one that got in as the server was stopping gets no further than a stopped one would
+			if (server.stopping) shutdown(fd, SHUT_RD);
+			server.connections.insert(fd);
+		}
+		std::thread(serve_connection, std::ref(server), fd).detach();
+	}
+	// a shutdown stops new connections, the open ones finish what they're doing
+	{
+		std::unique_lock<std::mutex> lock(server.mutex);
+		server.closed.wait(lock, [&] { return server.connections.empty(); });
+	}
+	close(server.listener);
+	unlink(socket_path);
+	return server.stopping;
+}
@@ -0,0 +1,52 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <cstddef>
+#include <string>
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "pipeline.h"
+#include "texture.h"
+#include "tgaimage.h"
+#include "thread_pool.h"
+
+// everything one render job can ask for. the server starts every job from the settings it was
+// started with and lets the job's message override any of them
+struct RenderJob {
+	std::string model;
+	std::string texture;
+	std::string output;
+	std::string format;   // an ImageFormat name, or empty to go by output's extension
+	int width, height;
+	Vec3f eye, target, light;
+	float fov, ortho;     // 0 for the camera's defaults
+	float near, far;
+	ShadeMode shade;
+	TextureFilter filter;
+	TextureWrap wrap;
+	DepthFormat depth;
+	TGAColor background;
+};
+
+// run as a render server: read jobs, one json object per line, render each and answer it with a
+// json line of its own, until the input ends or a {"command": "shutdown"} comes. with no
+// socket_path (or "-") jobs come on stdin and answers go to stdout. otherwise the server listens
+// on a unix domain socket there, taking any number of connections at once, each answered in
+// order on its own thread. a job looks like
+//   {"id": 7, "model": "a.obj", "texture": "a.tga", "eye": [0, 0, 4], "look_at": [0, 0, 0],
+//    "light": [3, 0, 1], "width": 1024, "height": 1024, "output": "out.qoi"}
+// with "fov", "ortho", "near", "far", "shade", "filter", "wrap", "depth" and "format" too, and
+// anything left out taken from defaults. the answer gives the output, the time taken in all and
+// in each part (loading, drawing, writing), whether the assets were cached, or an error:
+//   {"id": 7, "ok": true, "output": "out.qoi", "ms": 41.2, "load_ms": 0.01, ...}
+//   {"id": 7, "ok": false, "error": "can't load the model"}
+// {"command": "stats"} answers with what the cache holds.
+// models and textures stay loaded in an AssetCache of cache_bytes, so repeat jobs only pay for
+// drawing and writing. every job draws on the one shared pool, jobs from different connections
+// taking turns for it. a job bigger than max_pixels, or one that fails (say for memory), gets an
+// error and the server carries on. a shutdown also stops the server reading from every other
+// connection, answering only what they've already sent. returns false if the socket couldn't be
+// set up, which it won't be over anything but a socket left behind at socket_path
+bool serve(const char *socket_path, const RenderJob &defaults, const RasterOptions &options, long long max_pixels, size_t cache_bytes, ThreadPool &pool);
+
+#endif //__SERVER_H__
@@ -0,0 +1,249 @@
+#ifndef __SHADERS_H__
+#define __SHADERS_H__
+
+#include <climits>
+#include <cmath>
+#include "assembly.h"
+#include "geometry.h"
+#include "texture.h"
+#include "tgaimage.h"
+
+// a shader is any copyable class with
+//   static const int VARYINGS;
+//     how many floats it interpolates across a triangle
+//   static const int TEXTURE_SAMPLES;
+//     how many texture lookups a fragment makes, for the counters
+//   void begin(const ScreenTriangle &t);
+//     once per triangle, before anything else. for whatever's constant over the triangle
+//   void vertex(const ScreenTriangle &t, int corner, float *varyings) const;
+//     the vertex shader: fill in the VARYINGS floats at corner 0 (a), 1 (b) or 2 (c)
+//   TGAColor fragment(const VaryingPlanes<VARYINGS> &planes, const float *varyings) const;
+//     the fragment shader: the color of a pixel that passed the depth test, given the
+//     varyings interpolated to its center. planes also has their screen space derivatives
+//     and the pixel's depth there
+// the pipeline is templated on the shader, so every mode gets its own raster loop with the
+// shader inlined into it, and nothing is decided per pixel
+
+// varyings interpolated across a triangle with the perspective taken into account.
+// v itself isn't linear on screen once it's been through a perspective divide, but v / w and
+// 1 / w are, so both go into plane equations p = value + dx * (x - x0) + dy * (y - y0) set up
+// once per triangle from its edge functions, and every pixel divides one by the other.
+// pixels are expected a row at a time, so the y part of every plane is only added in when the
+// row changes, leaving a multiply-add per float and one reciprocal per pixel.
+// depth already is linear on screen and gets a plain plane of its own
+template <int N>
+struct VaryingPlanes {
+	static const int SIZE = N > 0 ? N : 1;
+	// the scalars start at 0 only so the compiler can see they're never read before setup()
+	float x0 = 0, y0 = 0;
+	float value[SIZE];          // varying / w at (x0, y0)
+	float dx[SIZE];             // change one pixel right
+	float dy[SIZE];             // change one pixel up
+	float q = 0, q_dx = 0, q_dy = 0; // 1 / w the same way
+	float z = 0, z_dx = 0, z_dy = 0; // and depth
+	// where at() got to: the row and its planes at x0, then the pixel and its w
+	int row_y = INT_MIN;
+	float row[SIZE];
+	float row_q = 0;
+	float fx = 0, fy = 0, w = 0;
+
+	// planes through corner values v[0] v[1] v[2] at a b c of t
+	void setup(const ScreenTriangle &t, const float (*v)[SIZE]) {
+		x0 = t.a.x;
+		y0 = t.a.y;
+		auto inv_w = t.inv_w;
+		plane(t, inv_w.x, inv_w.y, inv_w.z, q, q_dx, q_dy);
+		plane(t, t.a.z, t.b.z, t.c.z, z, z_dx, z_dy);
+		for (auto i = 0; i < N; ++i) {
+			plane(t, v[0][i] * inv_w.x, v[1][i] * inv_w.y, v[2][i] * inv_w.z, value[i], dx[i], dy[i]);
+		}
+		row_y = INT_MIN;
+	}
+
+	// every varying at the center of pixel (x, y)
+	inline void at(int x, int y, float *out) {
+		if (y != row_y) {
+			row_y = y;
+			fy = y - y0;
+			row_q = q + q_dy * fy;
+			for (auto i = 0; i < N; ++i) row[i] = value[i] + dy[i] * fy;
+		}
+		fx = x - x0;
+		w = 1 / (row_q + q_dx * fx);
+		for (auto i = 0; i < N; ++i) out[i] = (row[i] + dx[i] * fx) * w;
+	}
+
+	// how varying i changes one pixel right and one up from the last pixel, v being its value
+	// there. with u = U / Q, du = (dU - u dQ) / Q
+	inline float ddx(int i, const float *v) const { return (dx[i] - v[i] * q_dx) * w; }
+	inline float ddy(int i, const float *v) const { return (dy[i] - v[i] * q_dy) * w; }
+
+	// depth at the last pixel
+	inline float depth() const { return z + z_dx * fx + z_dy * fy; }
+
+private:
+	// barycentric weights are E_i / area, and E_i steps by a per pixel in x and b per pixel in y
+	static void plane(const ScreenTriangle &t, float va, float vb, float vc, float &value, float &dx, float &dy) {
+		auto &e = t.setup.edges;
+		auto inv_area = t.setup.inv_area;
+		value = va;
+		dx = (va * float(e[0].a) + vb * float(e[1].a) + vc * float(e[2].a)) * inv_area;
+		dy = (va * float(e[0].b) + vb * float(e[1].b) + vc * float(e[2].b)) * inv_area;
+	}
+};
+
+// sample tex at (u, v) = (varyings[i], varyings[i + 1]), working out the texture's footprint
+// only if its filtering cares
+template <int N>
+inline TGAColor sample_texture(const Texture &tex, const VaryingPlanes<N> &planes, const float *varyings, int i) {
+	auto u = varyings[i];
+	auto v = varyings[i + 1];
+	if (tex.get_filter() != FILTER_TRILINEAR) return tex.sample(u, v);
+	auto duv_dx = Vec2f(planes.ddx(i, varyings), planes.ddx(i + 1, varyings));
+	auto duv_dy = Vec2f(planes.ddy(i, varyings), planes.ddy(i + 1, varyings));
+	return tex.sample(u, v, duv_dx, duv_dy);
+}
+
+// what the light does to a surface: (1 + cos theta) / 2 between the normal and the direction
+// towards the light, so the side facing away isn't pitch black, scaled down so the brightest
+// spot is 200 out of 255
+const float LIGHT_SCALE = 200.0f / 255;
+
+inline float illumination(Vec3f unit_normal, Vec3f towards_light) {
+	return (1 + unit_normal * towards_light) * 0.5f * LIGHT_SCALE;
+}
+
+// color * intensity, intensity in [0, 1]
+inline TGAColor modulate(TGAColor color, float intensity) {
+	return TGAColor(
+		static_cast<unsigned char>(color.r * intensity),
+		static_cast<unsigned char>(color.g * intensity),
+		static_cast<unsigned char>(color.b * intensity),
+		255
+	);
+}
+
+inline TGAColor grey(float intensity) {
+	auto level = static_cast<unsigned char>(255 * intensity);
+	return TGAColor(level, level, level, 255);
+}
+
+// 1 / |v|, for normalizing interpolated normals
+inline float inverse_length(float x, float y, float z) {
+	return 1 / std::sqrt(x * x + y * y + z * z);
+}
+
+// the shading modes, cheapest first
+enum ShadeMode {
+	SHADE_DEPTH,           // depth as grey, nearer is brighter
+	SHADE_FLAT,            // one light level per face, from its own normal
+	SHADE_GOURAUD,         // light worked out at the corners and blended
+	SHADE_PHONG,           // normals blended and lit at every pixel
+	SHADE_TEXTURED,        // the texture, unlit
+	SHADE_TEXTURED_PHONG   // the texture, lit like phong
+};
+
+const char *shade_mode_name(ShadeMode mode);
+// parse "depth", "flat", "gouraud", "phong", "textured" or "textured-phong", anything else is
+// textured-phong
+ShadeMode parse_shade_mode(const char *name);
+
+struct DepthShader {
+	static const int VARYINGS = 0;
+	static const int TEXTURE_SAMPLES = 0;
+	void begin(const ScreenTriangle &) {}
+	void vertex(const ScreenTriangle &, int, float *) const {}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &planes, const float *) const {
+		// depth falls off as 1 / distance, so stretch it out a little
+		return grey(std::min(1.0f, std::sqrt(std::max(0.0f, planes.depth()))));
+	}
+};
+
+struct FlatShader {
+	static const int VARYINGS = 0;
+	static const int TEXTURE_SAMPLES = 0;
+	Vec3f towards_light;
+	TGAColor color;
+	explicit FlatShader(Vec3f light) : towards_light(light) {}
+	void begin(const ScreenTriangle &t) {
+		color = grey(illumination(t.normal, towards_light));
+	}
+	void vertex(const ScreenTriangle &, int, float *) const {}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &, const float *) const {
+		return color;
+	}
+};
+
+struct GouraudShader {
+	static const int VARYINGS = 1;
+	static const int TEXTURE_SAMPLES = 0;
+	Vec3f towards_light;
+	explicit GouraudShader(Vec3f light) : towards_light(light) {}
+	void begin(const ScreenTriangle &) {}
+	void vertex(const ScreenTriangle &t, int corner, float *v) const {
+		auto n = corner == 0 ? t.an : corner == 1 ? t.bn : t.cn;
+		v[0] = illumination(n * inverse_length(n.x, n.y, n.z), towards_light);
+	}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &, const float *v) const {
+		return grey(v[0]);
+	}
+};
+
+struct PhongShader {
+	static const int VARYINGS = 3;
+	static const int TEXTURE_SAMPLES = 0;
+	Vec3f towards_light;
+	explicit PhongShader(Vec3f light) : towards_light(light) {}
+	void begin(const ScreenTriangle &) {}
+	void vertex(const ScreenTriangle &t, int corner, float *v) const {
+		auto n = corner == 0 ? t.an : corner == 1 ? t.bn : t.cn;
+		v[0] = n.x;
+		v[1] = n.y;
+		v[2] = n.z;
+	}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &, const float *v) const {
+		auto s = inverse_length(v[0], v[1], v[2]);
+		return grey(illumination(Vec3f(v[0] * s, v[1] * s, v[2] * s), towards_light));
+	}
+};
+
+struct TexturedShader {
+	static const int VARYINGS = 2;
+	static const int TEXTURE_SAMPLES = 1;
+	const Texture *texture;
+	explicit TexturedShader(const Texture &tex) : texture(&tex) {}
+	void begin(const ScreenTriangle &) {}
+	void vertex(const ScreenTriangle &t, int corner, float *v) const {
+		auto uv = corner == 0 ? t.at : corner == 1 ? t.bt : t.ct;
+		v[0] = uv.x;
+		v[1] = uv.y;
+	}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &planes, const float *v) const {
+		return sample_texture(*texture, planes, v, 0);
+	}
+};
+
+struct TexturedPhongShader {
+	static const int VARYINGS = 5; // u v, then the normal
+	static const int TEXTURE_SAMPLES = 1;
+	const Texture *texture;
+	Vec3f towards_light;
+	TexturedPhongShader(const Texture &tex, Vec3f light) : texture(&tex), towards_light(light) {}
+	void begin(const ScreenTriangle &) {}
+	void vertex(const ScreenTriangle &t, int corner, float *v) const {
+		auto uv = corner == 0 ? t.at : corner == 1 ? t.bt : t.ct;
+		auto n = corner == 0 ? t.an : corner == 1 ? t.bn : t.cn;
+		v[0] = uv.x;
+		v[1] = uv.y;
+		v[2] = n.x;
+		v[3] = n.y;
+		v[4] = n.z;
+	}
+	TGAColor fragment(const VaryingPlanes<VARYINGS> &planes, const float *v) const {
+		auto color = sample_texture(*texture, planes, v, 0);
+		auto s = inverse_length(v[2], v[3], v[4]);
+		return modulate(color, illumination(Vec3f(v[2] * s, v[3] * s, v[4] * s), towards_light));
+	}
+};
+
+#endif //__SHADERS_H__
@@ -0,0 +1,208 @@
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "banded.h"
+#include "mapped_file.h"
+#include "shard.h"
+
+const char *shard_split_name(ShardSplit split) {
+	return split == SHARD_GEOMETRY ? "geometry" : "rows";
+}
+
+ShardSplit parse_shard_split(const char *name) {
+	return !strcmp(name, "geometry") ? SHARD_GEOMETRY : SHARD_ROWS;
+}
+
+uint64_t shard_settings_hash(const std::string &settings) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char c : settings) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// the first of n things shard i of count gets, shard count's being n
+static int shard_start(int n, int i, int count) {
+	return static_cast<int>(static_cast<long long>(n) * i / count);
+}
+
+bool render_shard(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, TGAColor background, int width, int height,
+	DepthFormat format, ThreadPool &pool, const RasterOptions &options, int shard, int count, ShardSplit split, uint64_t settings, const char *filename, RenderStats &stats) {
+	std::vector<ScreenTriangle> triangles;
+	process_geometry(m, camera, width, height, pool, options, triangles, stats);
+
+	// the triangles this shard draws, in order, and where
+	auto y0 = 0, rows = height;
+	std::vector<ScreenTriangle> mine;
+	if (split == SHARD_ROWS) {
+		y0 = shard_start(height, shard, count);
+		rows = shard_start(height, shard + 1, count) - y0;
+		for (auto &t : triangles) {
+			if (t.setup.bounds.y1 > y0 && t.setup.bounds.y0 < y0 + rows) mine.push_back(band_triangle(t, y0, rows));
+		}
+	} else {
+		auto n = static_cast<int>(triangles.size());
+		mine.assign(triangles.begin() + shard_start(n, shard, count), triangles.begin() + shard_start(n, shard + 1, count));
+	}
+	std::vector<ScreenTriangle>().swap(triangles);
+
+	Framebuffer fb(width, rows, TILE_SIZE, format);
+	fb.set_origin_y(y0);
+	fb.clear(background);
+	draw_scene_triangles(mode, mine, texture, towards_light, fb, pool, options, stats);
+	{
+		StageTimer timer(stats.times, STAGE_ENCODE);
+		fb.resolve();
+	}
+
+	StageTimer timer(stats.times, STAGE_WRITE);
+	ShardHeader header;
+	memset((void *)&header, 0, sizeof(header));
+	memcpy(header.magic, SHARD_MAGIC, sizeof(header.magic));
+	header.version = SHARD_VERSION;
+	header.byte_order = SHARD_BYTE_ORDER;
+	header.shard = shard;
+	header.count = count;
+	header.split = split;
+	header.depth_format = format;
+	header.width = width;
+	header.height = height;
+	header.y0 = y0;
+	header.rows = rows;
+	header.background = background.b | background.g << 8 | background.r << 16;
+	header.settings = settings;
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+	auto pixels = static_cast<size_t>(width) * rows;
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(fb.get_image().buffer()), pixels * 3);
+	out.write(reinterpret_cast<const char *>(fb.depth_buffer()), pixels * sizeof(uint32_t));
+	if (!out.good()) {
+		std::cerr << "can't write file " << filename << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool merge_shards(const std::vector<std::string> &filenames, TGAImage &image) {
+	if (filenames.empty()) {
+		std::cerr << "no shards to merge\n";
+		return false;
+	}
+
+	// map every file and check it's a shard of the same render as the first
+	std::vector<std::unique_ptr<MappedFile>> files;
+	std::vector<const ShardHeader *> headers;
+	for (auto &name : filenames) {
+		files.emplace_back(new MappedFile());
+		auto &file = *files.back();
+		if (!file.open(name.c_str(), true)) {
+			std::cerr << "can't open file " << name << "\n";
+			return false;
+		}
+		auto h = reinterpret_cast<const ShardHeader *>(file.begin());
+		if (file.size() < sizeof(ShardHeader) || memcmp(h->magic, SHARD_MAGIC, sizeof(h->magic)) || h->version != SHARD_VERSION || h->byte_order != SHARD_BYTE_ORDER) {
+			std::cerr << name << " isn't a shard file this build can read\n";
+			return false;
+		}
+		auto &first = headers.empty() ? *h : *headers[0];
+		if (h->count != first.count || h->split != first.split || h->depth_format != first.depth_format || h->width != first.width || h->height != first.height || h->background != first.background || h->settings != first.settings) {
+			std::cerr << name << " is from a different render than " << filenames[0] << "\n";
+			return false;
+		}
+		auto pixels = static_cast<size_t>(h->width) * h->rows;
+		if (h->shard >= h->count || h->width > INT_MAX || h->height > INT_MAX || static_cast<uint64_t>(h->y0) + h->rows > h->height || file.size() != sizeof(ShardHeader) + pixels * (3 + sizeof(uint32_t))) {
+			std::cerr << name << " is damaged\n";
+			return false;
+		}
+		headers.push_back(h);
+	}
+
+	// a file for every shard, as many as the render was split into, before sizing anything by it
+	auto count = headers[0]->count;
+	if (count != filenames.size()) {
+		std::cerr << "the render was split " << count << " ways, but " << filenames.size() << " shards were given\n";
+		return false;
+	}
+	if (headers[0]->split == SHARD_ROWS && count > headers[0]->height) {
+		std::cerr << filenames[0] << " is damaged, it splits " << headers[0]->height << " rows " << count << " ways\n";
+		return false;
+	}
+	if (headers[0]->split == SHARD_GEOMETRY) {
+		for (size_t i = 0; i < headers.size(); ++i) {
+			if (headers[i]->rows != headers[0]->height) {
+				std::cerr << filenames[i] << " isn't the whole image\n";
+				return false;
+			}
+		}
+	}
+
+	// one of each shard, then in shard order
+	std::vector<int> order(count, -1);
+	for (size_t i = 0; i < headers.size(); ++i) {
+		auto &slot = order[headers[i]->shard];
+		if (slot >= 0) {
+			std::cerr << filenames[slot] << " and " << filenames[i] << " are the same shard\n";
+			return false;
+		}
+		slot = static_cast<int>(i);
+	}
+	for (uint32_t k = 0; k < count; ++k) {
+		if (order[k] < 0) {
+			std::cerr << "shard " << k << " of " << count << " is missing\n";
+			return false;
+		}
+	}
+
+	auto width = static_cast<int>(headers[0]->width);
+	auto height = static_cast<int>(headers[0]->height);
+	image = TGAImage(width, height, TGAImage::RGB);
+	auto out = image.buffer();
+	auto pixels = static_cast<size_t>(width) * height;
+
+	if (headers[0]->split == SHARD_ROWS) {
+		// the bands have to cover every row once
+		uint32_t next = 0;
+		for (auto i : order) {
+			auto h = headers[i];
+			if (h->y0 != next) {
+				std::cerr << filenames[i] << " starts at row " << h->y0 << ", not " << next << "\n";
+				return false;
+			}
+			memcpy(out + static_cast<size_t>(h->y0) * width * 3, files[i]->begin() + sizeof(ShardHeader), static_cast<size_t>(width) * h->rows * 3);
+			next += h->rows;
+		}
+		if (next != headers[0]->height) {
+			std::cerr << "the shards stop at row " << next << " of " << height << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// sort-last: starting from shard 0, a later shard only takes a pixel it's strictly nearer at
+	auto first = order[0];
+	memcpy(out, files[first]->begin() + sizeof(ShardHeader), pixels * 3);
+	std::vector<uint32_t> depth(pixels);
+	memcpy(depth.data(), files[first]->begin() + sizeof(ShardHeader) + pixels * 3, pixels * sizeof(uint32_t));
+	for (uint32_t k = 1; k < count; ++k) {
+		auto color = reinterpret_cast<const unsigned char *>(files[order[k]]->begin() + sizeof(ShardHeader));
+		// the depths follow 3 byte pixels, so they needn't be aligned
+		auto z = color + pixels * 3;
+		for (size_t p = 0; p < pixels; ++p) {
+			uint32_t d;
+			memcpy(&d, z + p * sizeof(uint32_t), sizeof(d));
+			if (d > depth[p]) {
+				depth[p] = d;
+				memcpy(out + 3 * p, color + 3 * p, 3);
+			}
+		}
+	}
+	return true;
+}
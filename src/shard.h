@@ -0,0 +1,70 @@
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "framebuffer.h"
+#include "model.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// how a frame is split between the processes rendering it
+enum ShardSplit {
+	SHARD_ROWS,    // each shard draws a band of rows of the image, the merge stitches them
+	SHARD_GEOMETRY // each shard draws a run of the triangles over the whole image, the merge
+	               // keeps the nearest of them at every pixel (sort-last)
+};
+
+const char *shard_split_name(ShardSplit split);
+// parse "rows" or "geometry", anything else is rows
+ShardSplit parse_shard_split(const char *name);
+
+// shard files are a header followed by the shard's color (3 bytes a pixel, bgr) then its depth
+// buffer (the encoded uint32_t depths), both a framebuffer row at a time from its bottom row, in
+// native byte order, for whatever rows of the image the shard holds
+const char SHARD_MAGIC[8] = {'R', 'S', 'H', 'A', 'R', 'D', 0, 0};
+const uint32_t SHARD_VERSION = 2;
+const uint32_t SHARD_BYTE_ORDER = 0x01020304;
+
+#pragma pack(push,1)
+struct ShardHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order; // SHARD_BYTE_ORDER as written
+	uint32_t shard;      // which of count this is
+	uint32_t count;
+	uint32_t split;      // a ShardSplit
+	uint32_t depth_format;
+	uint32_t width;      // of the whole image
+	uint32_t height;
+	uint32_t y0;         // the first image row the file holds (from the bottom), and how many
+	uint32_t rows;
+	uint32_t background; // what the image was cleared to, b g r from the low byte
+	uint64_t settings;   // shard_settings_hash of everything else the picture depends on
+};
+#pragma pack(pop)
+
+// a 64 bit fnv-1a hash of settings, a description of whatever a render's shards have to agree on
+// that the header doesn't already hold (the camera, the shading, the assets and so on)
+uint64_t shard_settings_hash(const std::string &settings);
+
+// draw shard of count of the width x height image m makes, split as split says, and write its
+// color and depth to filename, with settings (a shard_settings_hash) to check against at the
+// merge. rows are split as evenly as whole rows allow, triangles (after
+// assembly, which every shard runs in full) as evenly as whole triangles do, in order.
+// each pixel a shard draws comes out exactly as it would drawing the whole image in one go
+bool render_shard(ShadeMode mode, Model &m, const Camera &camera, const Texture &texture, Vec3f towards_light, TGAColor background, int width, int height,
+	DepthFormat format, ThreadPool &pool, const RasterOptions &options, int shard, int count, ShardSplit split, uint64_t settings, const char *filename, RenderStats &stats);
+
+// put the shard files back together into image (which gets resized), row 0 at the bottom. every
+// shard of one render (the same size, split and settings) has to be there, once, in any order. row shards are copied into place; geometry
+// shards are depth composited, the nearest depth winning and a tie going to the lower shard, the
+// same as a tie goes to the earlier triangle when drawing, so the image is bit-identical to
+// drawing it in one process. false (and a message) if the files don't make a whole image
+bool merge_shards(const std::vector<std::string> &filenames, TGAImage &image);
+
+#endif //__SHARD_H__
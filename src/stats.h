@@ -0,0 +1,74 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <ostream>
+#include "instrument.h"
+
+// counters gathered while drawing a frame. every tile (or thread) fills its own copy and they're
+// added together at the end, so nothing here needs to be atomic
+struct RenderStats {
+	long long vertices_transformed;    // vertices run through the vertex stage
+	long long vertex_transforms_saved; // ... compared to transforming 3 per face
+	long long faces_in;                // faces into primitive assembly
+	long long faces_outside;           // ... dropped for lying wholly outside the view
+	long long faces_clipped;           // ... cut at the near plane or guard band
+	long long triangles_back_facing;   // triangles dropped for facing away
+	long long triangles_empty;         // ... for covering no pixel
+	long long triangles_assembled;     // ... and the ones left to rasterize
+	long long triangles_rasterized;    // triangles handed to the rasterizer, once per tile they touch
+	long long triangles_hiz_culled;    // ... of those, the ones hierarchical z threw out entirely
+	long long blocks_tested;           // HIZ_BLOCK squares checked against hierarchical z
+	long long blocks_hiz_culled;       // ... of those, the ones skipped
+	// only counted when INSTRUMENTED
+	long long pixels_tested;           // covered pixels depth tested
+	long long pixels_passed;           // ... that were nearer than what was there, so got written
+	long long pixels_covered;          // pixels something ended up drawn on
+	long long fragments_shaded;        // fragment shader runs
+	long long texture_samples;         // ... and the texture lookups they made
+	StageTimes times;
+
+	RenderStats() : vertices_transformed(0), vertex_transforms_saved(0), faces_in(0), faces_outside(0), faces_clipped(0),
+		triangles_back_facing(0), triangles_empty(0), triangles_assembled(0), triangles_rasterized(0), triangles_hiz_culled(0), blocks_tested(0), blocks_hiz_culled(0),
+		pixels_tested(0), pixels_passed(0), pixels_covered(0), fragments_shaded(0), texture_samples(0) {
+	}
+
+	void add(const RenderStats &s) {
+		vertices_transformed += s.vertices_transformed;
+		vertex_transforms_saved += s.vertex_transforms_saved;
+		faces_in += s.faces_in;
+		faces_outside += s.faces_outside;
+		faces_clipped += s.faces_clipped;
+		triangles_back_facing += s.triangles_back_facing;
+		triangles_empty += s.triangles_empty;
+		triangles_assembled += s.triangles_assembled;
+		triangles_rasterized += s.triangles_rasterized;
+		triangles_hiz_culled += s.triangles_hiz_culled;
+		blocks_tested += s.blocks_tested;
+		blocks_hiz_culled += s.blocks_hiz_culled;
+		pixels_tested += s.pixels_tested;
+		pixels_passed += s.pixels_passed;
+		pixels_covered += s.pixels_covered;
+		fragments_shaded += s.fragments_shaded;
+		texture_samples += s.texture_samples;
+		times.add(s.times);
+	}
+
+	// depth writes per pixel drawn on: 1 when nothing got drawn over, 0 when nothing got drawn
+	double overdraw() const {
+		return pixels_covered ? double(pixels_passed) / pixels_covered : 0;
+	}
+};
+
+inline std::ostream &operator<<(std::ostream &s, const RenderStats &r) {
+	s << "# transformed " << r.vertices_transformed << " vertices, saving " << r.vertex_transforms_saved << " transforms\n";
+	s << "# assembled " << r.faces_in << " faces: " << r.faces_outside << " outside the view, " << r.faces_clipped << " clipped; "
+		<< r.triangles_back_facing << " back-facing and " << r.triangles_empty << " empty triangles dropped, "
+		<< r.triangles_assembled << " left\n";
+	if (r.blocks_tested) s << "# hi-z culled " << r.triangles_hiz_culled << " of " << r.triangles_rasterized << " triangles, "
+		<< r.blocks_hiz_culled << " of " << r.blocks_tested << " blocks\n";
+	if (r.pixels_tested) s << "# depth tested " << r.pixels_tested << " pixels, " << r.pixels_passed << " passed; "
+		<< r.pixels_covered << " covered (overdraw " << r.overdraw() << "), " << r.fragments_shaded << " shaded\n";
+	return s;
+}
+
+#endif //__STATS_H__
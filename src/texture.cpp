@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "texture.h"
+
+// texels are stored in square blocks TEXTURE_BLOCK texels across
+static const int TEXTURE_BLOCK_BITS = 2;
+static const int TEXTURE_BLOCK = 1 << TEXTURE_BLOCK_BITS;
+
+const char *texture_filter_name(TextureFilter filter) {
+	switch (filter) {
+		case FILTER_BILINEAR: return "bilinear";
+		case FILTER_TRILINEAR: return "trilinear";
+		default: return "nearest";
+	}
+}
+
+TextureFilter parse_texture_filter(const char *name) {
+	if (!strcmp(name, "bilinear")) return FILTER_BILINEAR;
+	if (!strcmp(name, "trilinear")) return FILTER_TRILINEAR;
+	return FILTER_NEAREST;
+}
+
+const char *texture_wrap_name(TextureWrap wrap) {
+	return wrap == WRAP_CLAMP ? "clamp" : "repeat";
+}
+
+TextureWrap parse_texture_wrap(const char *name) {
+	return !strcmp(name, "clamp") ? WRAP_CLAMP : WRAP_REPEAT;
+}
+
+// an empty level of the given size, padded out to whole blocks
+static void allocate_level(int width, int height, int &blocks_per_row, std::vector<uint32_t> &texels) {
+	blocks_per_row = (width + TEXTURE_BLOCK - 1) / TEXTURE_BLOCK;
+	auto block_rows = (height + TEXTURE_BLOCK - 1) / TEXTURE_BLOCK;
+	texels.assign(static_cast<size_t>(blocks_per_row) * block_rows * TEXTURE_BLOCK * TEXTURE_BLOCK, 0);
+}
+
+// where texel (x, y) lives in a level's storage, x and y can't be negative
+static inline size_t texel_index(int blocks_per_row, int x, int y) {
+	auto block = static_cast<size_t>(y >> TEXTURE_BLOCK_BITS) * blocks_per_row + (x >> TEXTURE_BLOCK_BITS);
+	return (block << (2 * TEXTURE_BLOCK_BITS)) + ((y & (TEXTURE_BLOCK - 1)) << TEXTURE_BLOCK_BITS) + (x & (TEXTURE_BLOCK - 1));
+}
+
+// std::floor, without the library call
+static inline int floor_to_int(float v) {
+	auto i = static_cast<int>(v);
+	return v < i ? i - 1 : i;
+}
+
+// blend two packed texels, t of the way (out of 256) from a to b
+static inline uint32_t lerp_texel(uint32_t a, uint32_t b, int t) {
+	uint32_t out = 0;
+	for (auto shift = 0; shift < 32; shift += 8) {
+		int ca = (a >> shift) & 0xff;
+		int cb = (b >> shift) & 0xff;
+		out |= static_cast<uint32_t>((ca * (256 - t) + cb * t + 128) >> 8) << shift;
+	}
+	return out;
+}
+
+Texture::Texture() : filter(FILTER_NEAREST), wrap(WRAP_REPEAT) {
+}
+
+Texture::Texture(TGAImage &image, TextureFilter filter, TextureWrap wrap) : filter(filter), wrap(wrap) {
+	auto width = image.get_width();
+	auto height = image.get_height();
+	auto bytespp = image.get_bytespp();
+	auto data = image.buffer();
+	if (!data || width <= 0 || height <= 0) return;
+
+	// convert to b g r a once, whatever the image was stored as
+	Level base;
+	base.width = width;
+	base.height = height;
+	allocate_level(width, height, base.blocks_per_row, base.texels);
+	for (auto y = 0; y < height; ++y) {
+		auto p = data + static_cast<size_t>(y) * width * bytespp;
+		for (auto x = 0; x < width; ++x, p += bytespp) {
+			uint32_t b, g, r, a;
+			if (bytespp == 1) {
+				b = g = r = p[0];
+				a = 255;
+			} else {
+				b = p[0];
+				g = p[1];
+				r = p[2];
+				a = bytespp == 4 ? p[3] : 255;
+			}
+			base.texels[texel_index(base.blocks_per_row, x, y)] = b | g << 8 | r << 16 | a << 24;
+		}
+	}
+	levels.push_back(std::move(base));
+	if (filter == FILTER_TRILINEAR) build_mips();
+}
+
+void Texture::build_mips() {
+	// every level halves the one before it (rounding down, never below 1) with a box filter.
+	// odd sizes just repeat the last row or column
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		auto &above = levels.back();
+		Level level;
+		level.width = std::max(1, above.width / 2);
+		level.height = std::max(1, above.height / 2);
+		allocate_level(level.width, level.height, level.blocks_per_row, level.texels);
+		for (auto y = 0; y < level.height; ++y) {
+			auto y0 = std::min(2 * y, above.height - 1);
+			auto y1 = std::min(2 * y + 1, above.height - 1);
+			for (auto x = 0; x < level.width; ++x) {
+				auto x0 = std::min(2 * x, above.width - 1);
+				auto x1 = std::min(2 * x + 1, above.width - 1);
+				uint32_t corners[4] = {texel(above, x0, y0), texel(above, x1, y0), texel(above, x0, y1), texel(above, x1, y1)};
+				uint32_t out = 0;
+				for (auto shift = 0; shift < 32; shift += 8) {
+					uint32_t sum = 2;
+					for (auto c : corners) sum += (c >> shift) & 0xff;
+					out |= (sum >> 2) << shift;
+				}
+				level.texels[texel_index(level.blocks_per_row, x, y)] = out;
+			}
+		}
+		levels.push_back(std::move(level));
+	}
+}
+
+void Texture::set_sampling(TextureFilter f, TextureWrap w) {
+	filter = f;
+	wrap = w;
+	if (filter == FILTER_TRILINEAR && levels.size() == 1) build_mips();
+}
+
+inline uint32_t Texture::texel(const Level &level, int x, int y) const {
+	return level.texels[texel_index(level.blocks_per_row, x, y)];
+}
+
+inline int Texture::wrap_coordinate(int i, int size) const {
+	// nearly every lookup is already inside, so skip the division
+	if (static_cast<unsigned>(i) < static_cast<unsigned>(size)) return i;
+	if (wrap == WRAP_CLAMP) return i < 0 ? 0 : size - 1;
+	i %= size;
+	return i < 0 ? i + size : i;
+}
+
+uint32_t Texture::sample_nearest(const Level &level, float u, float v) const {
+	auto x = floor_to_int(u * level.width);
+	auto y = floor_to_int(v * level.height);
+	return texel(level, wrap_coordinate(x, level.width), wrap_coordinate(y, level.height));
+}
+
+uint32_t Texture::sample_bilinear(const Level &level, float u, float v) const {
+	// texel centers sit at half coordinates, weights are in 1/256ths
+	auto tx = u * level.width - 0.5f;
+	auto ty = v * level.height - 0.5f;
+	auto fx = floor_to_int(tx);
+	auto fy = floor_to_int(ty);
+	auto wx = static_cast<int>((tx - fx) * 256);
+	auto wy = static_cast<int>((ty - fy) * 256);
+	auto x0 = wrap_coordinate(fx, level.width);
+	auto x1 = wrap_coordinate(fx + 1, level.width);
+	auto y0 = wrap_coordinate(fy, level.height);
+	auto y1 = wrap_coordinate(fy + 1, level.height);
+	auto top = lerp_texel(texel(level, x0, y0), texel(level, x1, y0), wx);
+	auto bottom = lerp_texel(texel(level, x0, y1), texel(level, x1, y1), wx);
+	return lerp_texel(top, bottom, wy);
+}
+
+float Texture::lod(Vec2f duv_dx, Vec2f duv_dy) const {
+	if (levels.empty()) return 0;
+	auto w = float(levels[0].width);
+	auto h = float(levels[0].height);
+	// how many texels one pixel step covers, along whichever screen axis covers more
+	auto dx = (duv_dx.x * w) * (duv_dx.x * w) + (duv_dx.y * h) * (duv_dx.y * h);
+	auto dy = (duv_dy.x * w) * (duv_dy.x * w) + (duv_dy.y * h) * (duv_dy.y * h);
+	auto rho2 = std::max(dx, dy);
+	// log2(sqrt(rho2)), anything that small is magnified anyway
+	return rho2 > 0 ? 0.5f * std::log2(rho2) : -32.0f;
+}
+
+TGAColor Texture::sample(float u, float v, Vec2f duv_dx, Vec2f duv_dy) const {
+	if (levels.empty()) return TGAColor();
+	if (filter == FILTER_NEAREST) return TGAColor(sample_nearest(levels[0], u, v), 4);
+	if (filter == FILTER_BILINEAR) return TGAColor(sample_bilinear(levels[0], u, v), 4);
+
+	auto l = lod(duv_dx, duv_dy);
+	auto last = static_cast<int>(levels.size()) - 1;
+	if (l <= 0) return TGAColor(sample_bilinear(levels[0], u, v), 4);
+	if (l >= last) return TGAColor(sample_bilinear(levels[last], u, v), 4);
+	auto fine = static_cast<int>(l);
+	auto t = static_cast<int>((l - fine) * 256);
+	auto a = sample_bilinear(levels[fine], u, v);
+	auto b = sample_bilinear(levels[fine + 1], u, v);
+	return TGAColor(lerp_texel(a, b, t), 4);
+}
+
+int Texture::get_width() const {
+	return levels.empty() ? 0 : levels[0].width;
+}
+
+int Texture::get_height() const {
+	return levels.empty() ? 0 : levels[0].height;
+}
+
+int Texture::get_levels() const {
+	return static_cast<int>(levels.size());
+}
+
+TextureFilter Texture::get_filter() const {
+	return filter;
+}
+
+size_t Texture::memory_size() const {
+	size_t bytes = 0;
+	for (auto &level : levels) bytes += level.texels.size() * sizeof(uint32_t);
+	return bytes;
+}
@@ -0,0 +1,71 @@
+#ifndef __TEXTURE_H__
+#define __TEXTURE_H__
+
+#include <cstdint>
+#include <vector>
+#include "geometry.h"
+#include "tgaimage.h"
+
+// how a texture is filtered
+enum TextureFilter {
+	FILTER_NEAREST,  // the texel under the sample, from the full size image
+	FILTER_BILINEAR, // the 4 texels around the sample blended, from the full size image
+	FILTER_TRILINEAR // bilinear in the two mip levels nearest the footprint, blended
+};
+
+// what happens to texture coordinates outside [0, 1)
+enum TextureWrap {
+	WRAP_REPEAT, // the texture tiles
+	WRAP_CLAMP   // the edge texels stretch out
+};
+
+const char *texture_filter_name(TextureFilter filter);
+// parse "nearest", "bilinear" or "trilinear", anything else is nearest
+TextureFilter parse_texture_filter(const char *name);
+const char *texture_wrap_name(TextureWrap wrap);
+// parse "repeat" or "clamp", anything else is repeat
+TextureWrap parse_texture_wrap(const char *name);
+
+// an image prepared for sampling. texels are converted once to 32 bits each, in TGAColor's byte
+// order (b g r a) so one converts to a TGAColor as is, and stored in TEXTURE_BLOCK square blocks
+// so the texels a bilinear lookup (or a triangle's span) touches sit close together in memory.
+// a full mip chain, down to 1x1, is built by averaging 2x2 texels, as soon as trilinear filtering
+// needs it.
+// coordinates are (u, v) in [0, 1], with v = 0 on row 0 of the image
+class Texture {
+private:
+	struct Level {
+		int width;
+		int height;
+		int blocks_per_row;
+		std::vector<uint32_t> texels;
+	};
+	std::vector<Level> levels;
+	TextureFilter filter;
+	TextureWrap wrap;
+
+	void build_mips();
+	uint32_t texel(const Level &level, int x, int y) const;
+	int wrap_coordinate(int i, int size) const;
+	uint32_t sample_nearest(const Level &level, float u, float v) const;
+	uint32_t sample_bilinear(const Level &level, float u, float v) const;
+public:
+	Texture();
+	Texture(TGAImage &image, TextureFilter filter = FILTER_NEAREST, TextureWrap wrap = WRAP_REPEAT);
+	void set_sampling(TextureFilter filter, TextureWrap wrap);
+
+	// the mip level a pixel should read from when u and v change by duv_dx across a pixel and
+	// duv_dy down one. 0 is the full image, anything below is magnified
+	float lod(Vec2f duv_dx, Vec2f duv_dy) const;
+	// filter the texture at (u, v). duv_dx and duv_dy are only needed for trilinear filtering
+	TGAColor sample(float u, float v, Vec2f duv_dx = Vec2f(), Vec2f duv_dy = Vec2f()) const;
+
+	int get_width() const;
+	int get_height() const;
+	int get_levels() const;
+	TextureFilter get_filter() const;
+	// bytes the texels of every level take
+	size_t memory_size() const;
+};
+
+#endif //__TEXTURE_H__
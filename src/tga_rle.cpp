@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+#include "tga_rle.h"
+#include "thread_pool.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TGA_RLE_SSE2 1
+#endif
+
+// the most pixels one packet holds, literal or run
+static const int MAX_PACKET = 128;
+// rows per band when encoding in parallel, at the least
+static const int MIN_BAND_ROWS = 16;
+
+// how many equal pixels in a row are worth breaking a literal packet for. a run packet of 2
+// costs 1 + bytespp against 2 * bytespp inside the literal, and the literal after it needs a
+// header of its own: for 2 bytes or more per pixel that's no bigger, for grayscale it takes 3.
+// a packet that starts on a pair is always a run, that's never bigger either
+template <int BPP>
+struct MinRun {
+	static const int VALUE = BPP > 1 ? 2 : 3;
+};
+
+template <int BPP>
+static inline bool same_pixel(const unsigned char *a, const unsigned char *b) {
+	for (auto t = 0; t < BPP; ++t) {
+		if (a[t] != b[t]) return false;
+	}
+	return true;
+}
+
+// does a run packet start at pixel j of a row of n: the next MinRun pixels (or however many
+// are left, if that's 2 or more) are all the same
+template <int BPP>
+static inline bool run_starts(const unsigned char *row, int j, int n) {
+	auto len = std::min(MinRun<BPP>::VALUE, n - j);
+	if (len < 2) return false;
+	for (auto k = 1; k < len; ++k) {
+		if (!same_pixel<BPP>(row + (j + k - 1) * BPP, row + (j + k) * BPP)) return false;
+	}
+	return true;
+}
+
+#ifdef TGA_RLE_SSE2
+
+// what neighbor_mask reads past a pixel, and how many pixels it covers
+static const int SIMD_BYTES = 16;
+
+template <int BPP>
+struct Block {
+	static const int PIXELS = SIMD_BYTES / BPP;
+	// a bit at the first byte of each of those pixels
+	static const unsigned STRIDE = BPP == 1 ? 0xffff : BPP == 2 ? 0x5555 : BPP == 3 ? 0x1249 : 0x1111;
+};
+
+// bit t * BPP is set when pixel t equals pixel t + 1, for the Block<BPP>::PIXELS pixels from p.
+// reads SIMD_BYTES + BPP bytes
+template <int BPP>
+static inline unsigned neighbor_mask(const unsigned char *p) {
+	auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + BPP));
+	unsigned equal = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+	// every byte of the pixel has to match
+	auto all = equal;
+	for (auto s = 1; s < BPP; ++s) all &= equal >> s;
+	return all & Block<BPP>::STRIDE;
+}
+
+// can neighbor_mask run at pixel j of a row of n without reading past it
+template <int BPP>
+static inline bool block_fits(int j, int n) {
+	return (n - j) * BPP >= SIMD_BYTES + 2 * BPP;
+}
+
+#endif //TGA_RLE_SSE2
+
+// the first pixel in [j, limit) a run packet starts at, limit if none does
+template <int BPP>
+static inline int next_run_start(const unsigned char *row, int j, int limit, int n) {
+#ifdef TGA_RLE_SSE2
+	while (j < limit && block_fits<BPP>(j, n)) {
+		auto m = neighbor_mask<BPP>(row + j * BPP);
+		auto covered = Block<BPP>::PIXELS;
+		if (MinRun<BPP>::VALUE == 3) {
+			// the next pair has to match too, which the last pixel of the block can't tell
+			m &= m >> BPP;
+			covered--;
+			m &= (1u << (covered * BPP)) - 1;
+		}
+		if (m) return std::min(j + __builtin_ctz(m) / BPP, limit);
+		j += covered;
+	}
+#endif
+	while (j < limit && !run_starts<BPP>(row, j, n)) ++j;
+	return std::min(j, limit);
+}
+
+// one past the last pixel of the run packet starting at pixel i of a row of n
+template <int BPP>
+static inline int run_end(const unsigned char *row, int i, int n) {
+	auto limit = std::min(n, i + MAX_PACKET);
+	// pixels i to k are all the same
+	auto k = i;
+#ifdef TGA_RLE_SSE2
+	while (k + 1 < limit && block_fits<BPP>(k, n)) {
+		auto differs = neighbor_mask<BPP>(row + k * BPP) ^ Block<BPP>::STRIDE;
+		if (differs) return std::min(k + __builtin_ctz(differs) / BPP + 1, limit);
+		k += Block<BPP>::PIXELS;
+	}
+#endif
+	while (k + 1 < limit && same_pixel<BPP>(row + k * BPP, row + (k + 1) * BPP)) ++k;
+	return std::min(k + 1, limit);
+}
+
+// encode a row of n pixels into out, which has room for the worst case. returns the end
+template <int BPP>
+static unsigned char *encode_row(const unsigned char *row, int n, unsigned char *out) {
+	auto i = 0;
+	while (i < n) {
+		if (i + 1 < n && same_pixel<BPP>(row + i * BPP, row + (i + 1) * BPP)) {
+			auto end = run_end<BPP>(row, i, n);
+			*out++ = static_cast<unsigned char>(0x80 | (end - i - 1));
+			memcpy(out, row + i * BPP, BPP);
+			out += BPP;
+			i = end;
+		} else {
+			auto end = next_run_start<BPP>(row, i + 1, std::min(n, i + MAX_PACKET), n);
+			*out++ = static_cast<unsigned char>(end - i - 1);
+			memcpy(out, row + i * BPP, (end - i) * BPP);
+			out += (end - i) * BPP;
+			i = end;
+		}
+	}
+	return out;
+}
+
+static unsigned char *encode_row(const unsigned char *row, int n, int bytespp, unsigned char *out) {
+	switch (bytespp) {
+		case 1: return encode_row<1>(row, n, out);
+		case 2: return encode_row<2>(row, n, out);
+		case 3: return encode_row<3>(row, n, out);
+		default: return encode_row<4>(row, n, out);
+	}
+}
+
+// encode rows [y0, y1), appending to out
+static void encode_rows(const unsigned char *pixels, int width, int y0, int y1, int bytespp, std::vector<unsigned char> &out) {
+	auto row_bytes = static_cast<size_t>(width) * bytespp;
+	// all literal, with a header every MAX_PACKET pixels
+	auto worst = row_bytes + (width + MAX_PACKET - 1) / MAX_PACKET;
+	auto used = out.size();
+	for (auto y = y0; y < y1; ++y) {
+		if (out.size() < used + worst) out.resize(std::max(out.size() * 2, used + worst));
+		auto end = encode_row(pixels + y * row_bytes, width, bytespp, out.data() + used);
+		used = end - out.data();
+	}
+	out.resize(used);
+}
+
+void rle_encode(const unsigned char *pixels, int width, int height, int bytespp, std::vector<unsigned char> &out, ThreadPool *pool) {
+	auto bands = 1;
+	if (pool && pool->size() > 1) bands = std::min(pool->size() * 4, height / MIN_BAND_ROWS);
+	if (bands <= 1) {
+		encode_rows(pixels, width, 0, height, bytespp, out);
+		return;
+	}
+
+	// packets never cross a row, so the bands' packets just go one after another
+	std::vector<std::vector<unsigned char>> encoded(bands);
+	pool->parallel_for(bands, [&](int band) {
+		auto y0 = static_cast<int>(static_cast<long long>(height) * band / bands);
+		auto y1 = static_cast<int>(static_cast<long long>(height) * (band + 1) / bands);
+		encoded[band].reserve(static_cast<size_t>(y1 - y0) * width * bytespp / 2);
+		encode_rows(pixels, width, y0, y1, bytespp, encoded[band]);
+	});
+	auto total = out.size();
+	for (auto &e : encoded) total += e.size();
+	out.reserve(total);
+	for (auto &e : encoded) out.insert(out.end(), e.begin(), e.end());
+}
+
+// count copies of the bytespp byte pixel into out, doubling what's been filled each step
+static void fill_run(unsigned char *out, const unsigned char *pixel, size_t count, int bytespp) {
+	if (bytespp == 1) {
+		memset(out, *pixel, count);
+		return;
+	}
+	auto total = count * bytespp;
+	memcpy(out, pixel, bytespp);
+	size_t filled = bytespp;
+	while (filled < total) {
+		auto n = std::min(filled, total - filled);
+		memcpy(out + filled, out, n);
+		filled += n;
+	}
+}
+
+const unsigned char *rle_decode(const unsigned char *in, const unsigned char *end, unsigned char *pixels, size_t npixels, int bytespp) {
+	auto out = pixels;
+	auto out_end = pixels + npixels * bytespp;
+	while (out < out_end) {
+		if (in >= end) return nullptr;
+		auto header = *in++;
+		size_t count = (header & 0x7f) + 1;
+		auto bytes = count * bytespp;
+		if (bytes > static_cast<size_t>(out_end - out)) return nullptr;
+		if (header < 0x80) {
+			if (bytes > static_cast<size_t>(end - in)) return nullptr;
+			memcpy(out, in, bytes);
+			in += bytes;
+		} else {
+			if (static_cast<size_t>(end - in) < static_cast<size_t>(bytespp)) return nullptr;
+			fill_run(out, in, count, bytespp);
+			in += bytespp;
+		}
+		out += bytes;
+	}
+	return in;
+}
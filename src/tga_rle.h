@@ -0,0 +1,22 @@
+#ifndef __TGA_RLE_H__
+#define __TGA_RLE_H__
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// run-length encode width x height pixels of bytespp bytes each (1 to 4), as tga packets:
+// a header byte, then either up to 128 literal pixels or one pixel repeated up to 128 times.
+// no packet crosses the end of a row (as the tga spec asks), so bands of rows are encoded
+// on pool (if given) independently and joined. pixels equal to their neighbor are found
+// 16 bytes at a time, and a literal packet is only broken for a run when that doesn't make
+// the output bigger. appends to out
+void rle_encode(const unsigned char *pixels, int width, int height, int bytespp, std::vector<unsigned char> &out, ThreadPool *pool = nullptr);
+
+// decode tga packets from [in, end) into npixels pixels of bytespp bytes each. literal packets
+// are copied whole, runs filled by doubling. returns where the packets stopped, or nullptr if
+// they ran out early or overran the image
+const unsigned char *rle_decode(const unsigned char *in, const unsigned char *end, unsigned char *pixels, size_t npixels, int bytespp);
+
+#endif //__TGA_RLE_H__
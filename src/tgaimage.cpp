@@ -1,6 +1,10 @@
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <vector>
 #include "tgaimage.h"
+#include "mapped_file.h"
+#include "tga_rle.h"
 
 TGAImage::TGAImage() : data(NULL), width(0), height(0), bytespp(0) {
 }
@@ -41,6 +45,7 @@ TGAImage & TGAImage::operator =(const TGAImage &img) {
  *
  * Reads a .tga file into a TGAImage object
  *
+ * the file is mapped in whole, and raw or rle pixel data decoded straight out of it
  *
  */
 bool TGAImage::read_tga_file(const char *filename) {
@@ -48,24 +53,22 @@ bool TGAImage::read_tga_file(const char *filename) {
 	// clear out any existing data
 	if (data) delete [] data;
 	data = NULL;
-	std::ifstream in;
 
 	// open the file
-	in.open (filename, std::ios::binary);
-	if (!in.is_open()) {
-		std::cerr << "can't open file " << filename << "\n";
-		in.close();
+	MappedFile in;
+	if (!in.open(filename, true)) {
 		return false;
 	}
 
 	// read the header into a struct
 	TGA_Header header;
-	in.read((char *)&header, sizeof(header));
-	if (!in.good()) {
-		in.close();
+	if (in.size() < sizeof(header)) {
 		std::cerr << "an error occured while reading the header\n";
 		return false;
 	}
+	memcpy(&header, in.begin(), sizeof(header));
+	auto pixels = reinterpret_cast<const unsigned char *>(in.begin()) + sizeof(header) + (unsigned char)header.idlength;
+	auto end = reinterpret_cast<const unsigned char *>(in.end());
 
 	/*
 	 * use header info to determine:
@@ -74,32 +77,29 @@ bool TGAImage::read_tga_file(const char *filename) {
 	 *   ...
 	 */
 
-	width   = header.width;
-	height  = header.height;
+	// the sizes are unsigned, up to 65535
+	width   = (unsigned short)header.width;
+	height  = (unsigned short)header.height;
 	bytespp = header.bitsperpixel>>3;
 	if (width<=0 || height<=0 || (bytespp!=GRAYSCALE && bytespp!=RGB && bytespp!=RGBA)) {
-		in.close();
 		std::cerr << "bad bpp (or width/height) value\n";
 		return false;
 	}
 
-	unsigned long nbytes = bytespp*width*height;
+	unsigned long nbytes = (unsigned long)bytespp*width*height;
 	data = new unsigned char[nbytes];
 	if (3==header.datatypecode || 2==header.datatypecode) {
-		in.read((char *)data, nbytes);
-		if (!in.good()) {
-			in.close();
+		if (pixels > end || (unsigned long)(end - pixels) < nbytes) {
 			std::cerr << "an error occured while reading the data\n";
 			return false;
 		}
+		memcpy(data, pixels, nbytes);
 	} else if (10==header.datatypecode||11==header.datatypecode) {
-		if (!load_rle_data(in)) {
-			in.close();
+		if (pixels > end || !rle_decode(pixels, end, data, (size_t)width*height, bytespp)) {
 			std::cerr << "an error occured while reading the data\n";
 			return false;
 		}
 	} else {
-		in.close();
 		std::cerr << "unknown file format " << (int)header.datatypecode << "\n";
 		return false;
 	}
@@ -110,63 +110,20 @@ bool TGAImage::read_tga_file(const char *filename) {
 		flip_horizontally();
 	}
 	std::cerr << width << "x" << height << "/" << bytespp*8 << "\n";
-	in.close();
 	return true;
 }
 
-bool TGAImage::load_rle_data(std::ifstream &in) {
-	unsigned long pixelcount = width*height;
-	unsigned long currentpixel = 0;
-	unsigned long currentbyte  = 0;
-	TGAColor colorbuffer;
-	do {
-		unsigned char chunkheader = 0;
-		chunkheader = in.get();
-		if (!in.good()) {
-			std::cerr << "an error occured while reading the data\n";
-			return false;
-		}
-		if (chunkheader<128) {
-			chunkheader++;
-			for (int i=0; i<chunkheader; i++) {
-				in.read((char *)colorbuffer.raw, bytespp);
-				if (!in.good()) {
-					std::cerr << "an error occured while reading the header\n";
-					return false;
-				}
-				for (int t=0; t<bytespp; t++)
-					data[currentbyte++] = colorbuffer.raw[t];
-				currentpixel++;
-				if (currentpixel>pixelcount) {
-					std::cerr << "Too many pixels read\n";
-					return false;
-				}
-			}
-		} else {
-			chunkheader -= 127;
-			in.read((char *)colorbuffer.raw, bytespp);
-			if (!in.good()) {
-				std::cerr << "an error occured while reading the header\n";
-				return false;
-			}
-			for (int i=0; i<chunkheader; i++) {
-				for (int t=0; t<bytespp; t++)
-					data[currentbyte++] = colorbuffer.raw[t];
-				currentpixel++;
-				if (currentpixel>pixelcount) {
-					std::cerr << "Too many pixels read\n";
-					return false;
-				}
-			}
-		}
-	} while (currentpixel < pixelcount);
-	return true;
-}
+/**
+ *
+ * Writes the image to a .tga file, run-length encoded unless rle is false
+ *
+ * the whole file is put together in memory by encode_tga and written out in one go
+ *
+ */
+bool TGAImage::write_tga_file(const char *filename, bool rle, ThreadPool *pool, bool bottom_up) {
+	std::vector<unsigned char> file;
+	if (!encode_tga(file, rle, pool, bottom_up)) return false;
 
-bool TGAImage::write_tga_file(const char *filename, bool rle) {
-	unsigned char developer_area_ref[4] = {0, 0, 0, 0};
-	unsigned char extension_area_ref[4] = {0, 0, 0, 0};
-	unsigned char footer[18] = {'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.','\0'};
 	std::ofstream out;
 	out.open (filename, std::ios::binary);
 	if (!out.is_open()) {
@@ -174,95 +131,52 @@ bool TGAImage::write_tga_file(const char *filename, bool rle) {
 		out.close();
 		return false;
 	}
-	TGA_Header header;
-	memset((void *)&header, 0, sizeof(header));
-	header.bitsperpixel = bytespp<<3;
-	header.width  = width;
-	header.height = height;
-	header.datatypecode = (bytespp==GRAYSCALE?(rle?11:3):(rle?10:2));
-	header.imagedescriptor = 0x20; // top-left origin
-	out.write((char *)&header, sizeof(header));
-	if (!out.good()) {
-		out.close();
-		std::cerr << "can't dump the tga file\n";
-		return false;
-	}
-	if (!rle) {
-		out.write((char *)data, width*height*bytespp);
-		if (!out.good()) {
-			std::cerr << "can't unload raw data\n";
-			out.close();
-			return false;
-		}
-	} else {
-		if (!unload_rle_data(out)) {
-			out.close();
-			std::cerr << "can't unload rle data\n";
-			return false;
-		}
-	}
-	out.write((char *)developer_area_ref, sizeof(developer_area_ref));
+	out.write((char *)file.data(), file.size());
 	if (!out.good()) {
 		std::cerr << "can't dump the tga file\n";
 		out.close();
 		return false;
 	}
-	out.write((char *)extension_area_ref, sizeof(extension_area_ref));
-	if (!out.good()) {
-		std::cerr << "can't dump the tga file\n";
-		out.close();
-		return false;
-	}
-	out.write((char *)footer, sizeof(footer));
-	if (!out.good()) {
-		std::cerr << "can't dump the tga file\n";
-		out.close();
+	out.close();
+	return true;
+}
+
+bool tga_encode_header(int width, int height, int bytespp, bool rle, bool bottom_up, std::vector<unsigned char> &out) {
+	if (width < 1 || height < 1 || width > 0xffff || height > 0xffff) {
+		std::cerr << "a tga can't be " << width << "x" << height << ", 65535 pixels a side at the most\n";
 		return false;
 	}
-	out.close();
+	TGA_Header header;
+	memset((void *)&header, 0, sizeof(header));
+	header.bitsperpixel = bytespp<<3;
+	header.width  = width;
+	header.height = height;
+	header.datatypecode = (bytespp==TGAImage::GRAYSCALE?(rle?11:3):(rle?10:2));
+	header.imagedescriptor = bottom_up ? 0x00 : 0x20; // bottom-left or top-left origin
+	out.insert(out.end(), (const unsigned char *)&header, (const unsigned char *)&header + sizeof(header));
 	return true;
 }
 
-// TODO: it is not necessary to break a raw chunk for two equal pixels (for the matter of the resulting size)
-bool TGAImage::unload_rle_data(std::ofstream &out) {
-	const unsigned char max_chunk_length = 128;
-	unsigned long npixels = width*height;
-	unsigned long curpix = 0;
-	while (curpix<npixels) {
-		unsigned long chunkstart = curpix*bytespp;
-		unsigned long curbyte = curpix*bytespp;
-		unsigned char run_length = 1;
-		bool raw = true;
-		while (curpix+run_length<npixels && run_length<max_chunk_length) {
-			bool succ_eq = true;
-			for (int t=0; succ_eq && t<bytespp; t++) {
-				succ_eq = (data[curbyte+t]==data[curbyte+t+bytespp]);
-			}
-			curbyte += bytespp;
-			if (1==run_length) {
-				raw = !succ_eq;
-			}
-			if (raw && succ_eq) {
-				run_length--;
-				break;
-			}
-			if (!raw && !succ_eq) {
-				break;
-			}
-			run_length++;
-		}
-		curpix += run_length;
-		out.put(raw?run_length-1:run_length+127);
-		if (!out.good()) {
-			std::cerr << "can't dump the tga file\n";
-			return false;
-		}
-		out.write((char *)(data+chunkstart), (raw?run_length*bytespp:bytespp));
-		if (!out.good()) {
-			std::cerr << "can't dump the tga file\n";
-			return false;
-		}
+void tga_encode_footer(std::vector<unsigned char> &out) {
+	unsigned char developer_area_ref[4] = {0, 0, 0, 0};
+	unsigned char extension_area_ref[4] = {0, 0, 0, 0};
+	unsigned char footer[18] = {'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.','\0'};
+	out.insert(out.end(), developer_area_ref, developer_area_ref + sizeof(developer_area_ref));
+	out.insert(out.end(), extension_area_ref, extension_area_ref + sizeof(extension_area_ref));
+	out.insert(out.end(), footer, footer + sizeof(footer));
+}
+
+// header, pixels (rle bands encoded on pool, if given) and footer
+bool TGAImage::encode_tga(std::vector<unsigned char> &file, bool rle, ThreadPool *pool, bool bottom_up) {
+	if (!tga_encode_header(width, height, bytespp, rle, bottom_up, file)) return false;
+	unsigned long nbytes = (unsigned long)width*height*bytespp;
+	file.reserve(file.size() + (rle ? nbytes / 2 : nbytes) + 26);
+	if (!rle) {
+		file.insert(file.end(), data, data + nbytes);
+	} else {
+		rle_encode(data, width, height, bytespp, file, pool);
 	}
+	tga_encode_footer(file);
 	return true;
 }
 
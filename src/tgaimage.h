@@ -2,6 +2,9 @@
 #define __IMAGE_H__
 
 #include <fstream>
+#include <vector>
+
+class ThreadPool;
 
 #pragma pack(push,1)
 struct TGA_Header {
@@ -20,6 +23,13 @@ struct TGA_Header {
 };
 #pragma pack(pop)
 
+// the header for a width x height tga of bytespp byte pixels, appended to out. bottom_up says
+// row 0 is the bottom of the picture. false (and nothing appended) if the size doesn't fit the
+// header's 16 bit fields, 65535 pixels a side
+bool tga_encode_header(int width, int height, int bytespp, bool rle, bool bottom_up, std::vector<unsigned char> &out);
+// the (empty) extension and developer area references and the tga 2.0 signature, after the pixels
+void tga_encode_footer(std::vector<unsigned char> &out);
+
 
 
 struct TGAColor {
@@ -66,9 +76,6 @@ protected:
 	int width;
 	int height;
 	int bytespp;
-
-	bool   load_rle_data(std::ifstream &in);
-	bool unload_rle_data(std::ofstream &out);
 public:
 	enum Format {
 		GRAYSCALE=1, RGB=3, RGBA=4
@@ -78,7 +85,11 @@ public:
 	TGAImage(int w, int h, int bpp);
 	TGAImage(const TGAImage &img);
 	bool read_tga_file(const char *filename);
-	bool write_tga_file(const char *filename, bool rle=true);
+	// bottom_up says row 0 is the bottom of the picture, which the header records rather than
+	// flipping the pixels
+	bool write_tga_file(const char *filename, bool rle=true, ThreadPool *pool=NULL, bool bottom_up=false);
+	// the whole file write_tga_file writes, appended to out. false if the image is too big for a tga
+	bool encode_tga(std::vector<unsigned char> &out, bool rle=true, ThreadPool *pool=NULL, bool bottom_up=false);
 	bool flip_horizontally();
 	bool flip_vertically();
 	bool scale(int w, int h);
@@ -0,0 +1,81 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int nthreads) : job(nullptr), job_size(0), next_index(0), generation(0), busy_workers(0), stopping(false) {
+	if (nthreads <= 0) {
+		nthreads = static_cast<int>(std::thread::hardware_concurrency());
+		if (nthreads <= 0) nthreads = 1;
+	}
+	// the caller is the first thread, so only spawn the rest
+	for (auto i = 1; i < nthreads; ++i) {
+		workers.emplace_back(&ThreadPool::worker_loop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto &w : workers) {
+		w.join();
+	}
+}
+
+int ThreadPool::size() {
+	return static_cast<int>(workers.size()) + 1;
+}
+
+// grab indices off the shared counter until there are none left
+void ThreadPool::drain(const std::function<void(int)> &fn, int n) {
+	for (auto i = next_index++; i < n; i = next_index++) {
+		fn(i);
+	}
+}
+
+void ThreadPool::worker_loop() {
+	unsigned long seen = 0;
+	for (;;) {
+		const std::function<void(int)> *fn;
+		int n;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+			// woke up too late, the caller already finished this job without us
+			if (!job) continue;
+			fn = job;
+			n = job_size;
+			++busy_workers;
+		}
+		drain(*fn, n);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--busy_workers;
+		}
+		done.notify_one();
+	}
+}
+
+void ThreadPool::parallel_for(int n, const std::function<void(int)> &fn) {
+	if (n <= 0) return;
+	if (workers.empty() || n == 1) {
+		for (auto i = 0; i < n; ++i) fn(i);
+		return;
+	}
+	std::lock_guard<std::mutex> turn(caller);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &fn;
+		job_size = n;
+		next_index = 0;
+		++generation;
+	}
+	wake.notify_all();
+	drain(fn, n);
+	// every index has been handed out, wait for the workers still chewing on theirs
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return busy_workers == 0; });
+	job = nullptr;
+}
@@ -0,0 +1,45 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of worker threads that chew through an index range together.
+// the calling thread works too, so a pool of size 1 has no workers at all
+// and everything runs inline (handy for debugging)
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::mutex caller; // held through a whole parallel_for, so callers on other threads take turns
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// the job currently being worked on
+	const std::function<void(int)> *job;
+	int job_size;
+	std::atomic<int> next_index;
+	unsigned long generation; // bumped for every new job so sleeping workers notice it
+	int busy_workers;
+	bool stopping;
+
+	void worker_loop();
+	void drain(const std::function<void(int)> &fn, int n);
+public:
+	// nthreads <= 0 means one thread per hardware core
+	ThreadPool(int nthreads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator =(const ThreadPool &) = delete;
+	int size();
+	// call fn(i) for every i in [0, n), spread over all threads. blocks until every call has returned.
+	// other threads may call it too (the output writer encodes on the renderer's pool), they wait
+	// for the job in flight to finish first. fn mustn't call it again though
+	void parallel_for(int n, const std::function<void(int)> &fn);
+};
+
+#endif //__THREAD_POOL_H__
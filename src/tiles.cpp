@@ -0,0 +1,52 @@
+#include <algorithm>
+#include "tiles.h"
+
+Rect Rect::intersect(const Rect &r) const {
+	return Rect(
+		std::max(x0, r.x0),
+		std::max(y0, r.y0),
+		std::min(x1, r.x1),
+		std::min(y1, r.y1)
+	);
+}
+
+TileGrid::TileGrid(int w, int h, int size) : width(w), height(h), tile_size(size) {
+	cols = (width + tile_size - 1) / tile_size;
+	rows = (height + tile_size - 1) / tile_size;
+	bins.resize(cols * rows);
+}
+
+int TileGrid::ntiles() {
+	return cols * rows;
+}
+
+Rect TileGrid::tile_rect(int tile) {
+	auto x0 = (tile % cols) * tile_size;
+	auto y0 = (tile / cols) * tile_size;
+	return Rect(x0, y0, std::min(x0 + tile_size, width), std::min(y0 + tile_size, height));
+}
+
+void TileGrid::bin(int face, const Rect &bounds) {
+	auto r = bounds.intersect(Rect(0, 0, width, height));
+	if (r.empty()) return;
+	// tiles overlapped by the (clamped) bounding box, inclusive
+	auto col_min = r.x0 / tile_size;
+	auto col_max = (r.x1 - 1) / tile_size;
+	auto row_min = r.y0 / tile_size;
+	auto row_max = (r.y1 - 1) / tile_size;
+	for (auto row = row_min; row <= row_max; ++row) {
+		for (auto col = col_min; col <= col_max; ++col) {
+			bins[col + row * cols].push_back(face);
+		}
+	}
+}
+
+const std::vector<int> &TileGrid::get_bin(int tile) const {
+	return bins[tile];
+}
+
+void TileGrid::clear() {
+	for (auto &b : bins) {
+		b.clear();
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include <vector>
+
+// a screen-space rectangle covering [x0, x1) x [y0, y1)
+struct Rect {
+	int x0, y0, x1, y1;
+	Rect() : x0(0), y0(0), x1(0), y1(0) {}
+	Rect(int _x0, int _y0, int _x1, int _y1) : x0(_x0), y0(_y0), x1(_x1), y1(_y1) {}
+	bool empty() const { return x0 >= x1 || y0 >= y1; }
+	Rect intersect(const Rect &r) const;
+};
+
+// the screen cut into fixed square tiles, each with the list of faces that touch it.
+// faces are binned in submission order, so drawing a tile's bin front to back gives
+// the same z-buffer results as drawing the whole model serially
+class TileGrid {
+private:
+	int width;
+	int height;
+	int tile_size;
+	int cols;
+	int rows;
+	std::vector<std::vector<int>> bins;
+public:
+	TileGrid(int w, int h, int size);
+	int ntiles();
+	Rect tile_rect(int tile);
+	// add face to every tile its bounding box overlaps
+	void bin(int face, const Rect &bounds);
+	const std::vector<int> &get_bin(int tile) const;
+	void clear();
+};
+
+#endif //__TILES_H__
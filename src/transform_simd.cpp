@@ -0,0 +1,76 @@
+#include "transform_simd.h"
+
+// points [first, n) one at a time
+static void transform_points_scalar(const Mat4f &m, int first, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow) {
+	for (auto i = first; i < n; ++i) {
+		auto p = m * Vec4f(x[i], y[i], z[i], 1);
+		ox[i] = p.x;
+		oy[i] = p.y;
+		oz[i] = p.z;
+		ow[i] = p.w;
+	}
+}
+
+#ifdef RENDERER_X86_SIMD
+
+// returns how many points it did, the rest are left for the scalar loop
+__attribute__((target("sse4.1")))
+static int transform_points_sse41(const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow) {
+	float *out[4] = {ox, oy, oz, ow};
+	__m128 rows[4][4];
+	for (auto r = 0; r < 4; ++r) {
+		for (auto c = 0; c < 4; ++c) rows[r][c] = _mm_set1_ps(m[r][c]);
+	}
+	auto i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		for (auto r = 0; r < 4; ++r) {
+			// ((m0 * x + m1 * y) + m2 * z) + m3, like Mat4f * Vec4f with w = 1
+			__m128 v = _mm_add_ps(_mm_mul_ps(rows[r][0], px), _mm_mul_ps(rows[r][1], py));
+			v = _mm_add_ps(v, _mm_mul_ps(rows[r][2], pz));
+			v = _mm_add_ps(v, _mm_mul_ps(rows[r][3], _mm_set1_ps(1.0f)));
+			_mm_storeu_ps(out[r] + i, v);
+		}
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static int transform_points_avx2(const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow) {
+	float *out[4] = {ox, oy, oz, ow};
+	__m256 rows[4][4];
+	for (auto r = 0; r < 4; ++r) {
+		for (auto c = 0; c < 4; ++c) rows[r][c] = _mm256_set1_ps(m[r][c]);
+	}
+	auto i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+		for (auto r = 0; r < 4; ++r) {
+			__m256 v = _mm256_add_ps(_mm256_mul_ps(rows[r][0], px), _mm256_mul_ps(rows[r][1], py));
+			v = _mm256_add_ps(v, _mm256_mul_ps(rows[r][2], pz));
+			v = _mm256_add_ps(v, _mm256_mul_ps(rows[r][3], _mm256_set1_ps(1.0f)));
+			_mm256_storeu_ps(out[r] + i, v);
+		}
+	}
+	return i;
+}
+
+#endif //RENDERER_X86_SIMD
+
+void transform_points(RasterIsa isa, const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow) {
+	auto done = 0;
+#ifdef RENDERER_X86_SIMD
+	if (isa == RASTER_AVX2) done = transform_points_avx2(m, n, x, y, z, ox, oy, oz, ow);
+	else if (isa == RASTER_SSE41) done = transform_points_sse41(m, n, x, y, z, ox, oy, oz, ow);
+#endif
+	transform_points_scalar(m, done, n, x, y, z, ox, oy, oz, ow);
+}
+
+void transform_points(const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow) {
+	static const auto isa = detect_raster_isa();
+	transform_points(isa, m, n, x, y, z, ox, oy, oz, ow);
+}
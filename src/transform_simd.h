@@ -0,0 +1,15 @@
+#ifndef __TRANSFORM_SIMD_H__
+#define __TRANSFORM_SIMD_H__
+
+#include "geometry.h"
+#include "raster_simd.h"
+
+// multiply n points (x, y, z, 1), given a component per array, by m into (ox, oy, oz, ow).
+// runs 4 or 8 points at a time on whatever isa allows, and every isa gives exactly the same
+// results as m * Vec4f(x, y, z, 1). outputs mustn't overlap the inputs
+void transform_points(RasterIsa isa, const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow);
+
+// same, on the widest isa the cpu has
+void transform_points(const Mat4f &m, int n, const float *x, const float *y, const float *z, float *ox, float *oy, float *oz, float *ow);
+
+#endif //__TRANSFORM_SIMD_H__
@@ -1,6 +1,7 @@
 #ifndef __UTIL_H__
 #define __UTIL_H__
 
+#include <string>
 #include "geometry.h"
 
 double vector_magnitude(Vec3f a, Vec3f b);
@@ -9,4 +10,11 @@ Vec3f cross_product(Vec3f a, Vec3f b);
 Vec3f get_normal(Vec3f a, Vec3f b, Vec3f c);
 Vec3f barycentric(Vec2i p, Vec3f v0, Vec3f v1, Vec3f v2);
 
+// whether name is one parse gives back as it was, the parsers taking anything they don't know as
+// their default
+template <typename T>
+bool known_name(const std::string &name, T (*parse)(const char *), const char *(*name_of)(T)) {
+	return name == name_of(parse(name.c_str()));
+}
+
 #endif //__UTIL_H__
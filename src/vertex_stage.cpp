@@ -0,0 +1,61 @@
+#include <algorithm>
+#include "vertex_stage.h"
+#include "thread_pool.h"
+#include "transform_simd.h"
+
+// positions per parallel job
+static const int VERTEX_BATCH = 16384;
+
+float clip_plane_distance(int plane, Vec4f p, int width, int height) {
+	// the screen matrix already includes the viewport, so x / w runs over [0, width] on screen
+	switch (plane) {
+		case CLIP_LEFT: return p.x;
+		case CLIP_RIGHT: return width * p.w - p.x;
+		case CLIP_BOTTOM: return p.y;
+		case CLIP_TOP: return height * p.w - p.y;
+		// depth is 1 at the near plane and 0 at the far one
+		case CLIP_NEAR: return p.w - p.z;
+		case CLIP_FAR: return p.z;
+		case CLIP_GUARD_LEFT: return p.x + GUARD_BAND * width * p.w;
+		case CLIP_GUARD_RIGHT: return (1 + GUARD_BAND) * width * p.w - p.x;
+		case CLIP_GUARD_BOTTOM: return p.y + GUARD_BAND * height * p.w;
+		case CLIP_GUARD_TOP: return (1 + GUARD_BAND) * height * p.w - p.y;
+	}
+	return 0;
+}
+
+uint16_t compute_outcode(Vec4f p, int width, int height) {
+	uint16_t code = 0;
+	for (auto plane = 1; plane <= CLIP_GUARD_TOP; plane <<= 1) {
+		if (clip_plane_distance(plane, p, width, height) < 0) code |= plane;
+	}
+	return code;
+}
+
+// the vertex stage over positions [first, last)
+static void transform_range(RasterIsa isa, const MeshView &mesh, const Mat4f &m, int width, int height, ScreenVertices &out, int first, int last) {
+	auto n = last - first;
+	transform_points(isa, m, n, mesh.vx + first, mesh.vy + first, mesh.vz + first, out.clip_x.data() + first, out.clip_y.data() + first, out.clip_z.data() + first, out.w.data() + first);
+	for (auto i = first; i < last; ++i) {
+		out.outcode[i] = compute_outcode(out.get_clip(i), width, height);
+		out.x[i] = out.clip_x[i] / out.w[i];
+		out.y[i] = out.clip_y[i] / out.w[i];
+		out.z[i] = out.clip_z[i] / out.w[i];
+	}
+}
+
+void transform_vertices(RasterIsa isa, const MeshView &mesh, const Mat4f &screen_matrix, int width, int height, ScreenVertices &out, ThreadPool *pool) {
+	for (auto v : {&out.clip_x, &out.clip_y, &out.clip_z, &out.w, &out.x, &out.y, &out.z}) {
+		v->resize(mesh.nverts);
+	}
+	out.outcode.resize(mesh.nverts);
+	auto batches = (mesh.nverts + VERTEX_BATCH - 1) / VERTEX_BATCH;
+	if (!pool || batches < 2) {
+		transform_range(isa, mesh, screen_matrix, width, height, out, 0, mesh.nverts);
+		return;
+	}
+	pool->parallel_for(batches, [&](int batch) {
+		auto first = batch * VERTEX_BATCH;
+		transform_range(isa, mesh, screen_matrix, width, height, out, first, std::min(first + VERTEX_BATCH, mesh.nverts));
+	});
+}
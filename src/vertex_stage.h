@@ -0,0 +1,54 @@
+#ifndef __VERTEX_STAGE_H__
+#define __VERTEX_STAGE_H__
+
+#include <cstdint>
+#include <vector>
+#include "geometry.h"
+#include "mesh.h"
+#include "raster_simd.h"
+
+class ThreadPool;
+
+// the planes a vertex can be outside of, as bits of an outcode. the first six bound what's
+// visible; the guard band lies well outside the screen and only exists so triangles reaching
+// absurdly far (towards infinity, as w nears 0) get clipped down to something the rasterizer's
+// fixed point can hold. anything between the screen edge and the guard band is left to the
+// rasterizer's own clipping
+enum ClipPlane {
+	CLIP_LEFT = 1, CLIP_RIGHT = 2, CLIP_BOTTOM = 4, CLIP_TOP = 8,
+	CLIP_NEAR = 16, CLIP_FAR = 32,
+	CLIP_GUARD_LEFT = 64, CLIP_GUARD_RIGHT = 128, CLIP_GUARD_BOTTOM = 256, CLIP_GUARD_TOP = 512
+};
+// triangles crossing these get clipped, the rest only decide whether a triangle is visible
+const int CLIP_PLANES_TO_CLIP = CLIP_NEAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP;
+// the guard band, in screen widths (heights) beyond each edge
+const float GUARD_BAND = 8;
+
+// the distance of clip space point p inside plane (negative outside), for a width x height screen
+float clip_plane_distance(int plane, Vec4f p, int width, int height);
+
+// which planes clip space point p is outside of
+uint16_t compute_outcode(Vec4f p, int width, int height);
+
+// every position of a mesh after the vertex stage, one array per component like the mesh itself.
+// faces index into it with the same indices they use for positions
+struct ScreenVertices {
+	std::vector<float> clip_x, clip_y, clip_z; // clip space, before the divide by w
+	std::vector<float> w;                      // the distance in front of a perspective camera
+	std::vector<float> x, y, z;                // screen position, z is depth in [0, 1] with 1 nearest
+	std::vector<uint16_t> outcode;             // ClipPlane bits
+	Vec3f get(int i) const {
+		return Vec3f(x[i], y[i], z[i]);
+	}
+	Vec4f get_clip(int i) const {
+		return Vec4f(clip_x[i], clip_y[i], clip_z[i], w[i]);
+	}
+};
+
+// run every position of mesh through screen_matrix (see Camera::screen_matrix), work out its
+// outcode against a width x height screen and divide by w, once, however many faces share it.
+// the positions are transformed in batches by isa's kernel in transform_simd.h, split across
+// pool (if given) when there are enough of them
+void transform_vertices(RasterIsa isa, const MeshView &mesh, const Mat4f &screen_matrix, int width, int height, ScreenVertices &out, ThreadPool *pool = nullptr);
+
+#endif //__VERTEX_STAGE_H__
@@ -0,0 +1,153 @@
+#include "yuv.h"
+
+// pixels [first, width), and the chroma they start, one at a time
+static void bgr_to_yuv420_scalar(int first, const unsigned char *top, const unsigned char *bottom, int width, unsigned char *y_top, unsigned char *y_bottom, unsigned char *cb, unsigned char *cr) {
+	for (auto x = first; x < width; x += 2) {
+		auto x1 = x + 1 < width ? x + 1 : x;
+		const unsigned char *p[4] = {top + 3 * x, top + 3 * x1, bottom + 3 * x, bottom + 3 * x1};
+		y_top[x] = rgb_to_y(p[0][2], p[0][1], p[0][0]);
+		y_bottom[x] = rgb_to_y(p[2][2], p[2][1], p[2][0]);
+		if (x1 != x) {
+			y_top[x1] = rgb_to_y(p[1][2], p[1][1], p[1][0]);
+			y_bottom[x1] = rgb_to_y(p[3][2], p[3][1], p[3][0]);
+		}
+		auto r = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+		auto g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+		auto b = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+		cb[x / 2] = rgb_to_cb(r, g, b);
+		cr[x / 2] = rgb_to_cr(r, g, b);
+	}
+}
+
+#ifdef RENDERER_X86_SIMD
+
+// pshufb masks pulling channel c (0 b, 1 g, 2 r) of 16 packed bgr pixels out of the k-th of
+// their three 16 byte loads, into one byte per pixel. 0x80 zeroes a lane
+struct BgrMasks {
+	alignas(16) unsigned char mask[3][3][16];
+	BgrMasks() {
+		for (auto c = 0; c < 3; ++c) {
+			for (auto k = 0; k < 3; ++k) {
+				for (auto i = 0; i < 16; ++i) {
+					auto byte = 3 * i + c;
+					mask[c][k][i] = byte / 16 == k ? static_cast<unsigned char>(byte % 16) : 0x80;
+				}
+			}
+		}
+	}
+};
+static const BgrMasks BGR_MASKS;
+
+// luma for 8 pixels' worth of 16 bit channels. the sum never passes 65535, so unsigned 16 bit
+// wrapping arithmetic gets it exactly
+#define YUV_LUMA(PREFIX, r, g, b) \
+	PREFIX##_add_epi16(PREFIX##_srli_epi16(PREFIX##_add_epi16(PREFIX##_add_epi16(PREFIX##_mullo_epi16(r, PREFIX##_set1_epi16(66)), \
+		PREFIX##_mullo_epi16(g, PREFIX##_set1_epi16(129))), PREFIX##_add_epi16(PREFIX##_mullo_epi16(b, PREFIX##_set1_epi16(25)), \
+		PREFIX##_set1_epi16(128))), 8), PREFIX##_set1_epi16(16))
+
+// chroma from averaged channels, kr kg kb the weights. the sums stay within signed 16 bits
+#define YUV_CHROMA(PREFIX, r, g, b, kr, kg, kb) \
+	PREFIX##_add_epi16(PREFIX##_srai_epi16(PREFIX##_add_epi16(PREFIX##_add_epi16(PREFIX##_mullo_epi16(r, PREFIX##_set1_epi16(kr)), \
+		PREFIX##_mullo_epi16(g, PREFIX##_set1_epi16(kg))), PREFIX##_add_epi16(PREFIX##_mullo_epi16(b, PREFIX##_set1_epi16(kb)), \
+		PREFIX##_set1_epi16(128))), 8), PREFIX##_set1_epi16(128))
+
+// returns how many pixels it did, an even number, the rest are left for the scalar loop
+__attribute__((target("sse4.1")))
+static int bgr_to_yuv420_sse41(const unsigned char *top, const unsigned char *bottom, int width, unsigned char *y_top, unsigned char *y_bottom, unsigned char *cb, unsigned char *cr) {
+	__m128i masks[3][3];
+	for (auto c = 0; c < 3; ++c) {
+		for (auto k = 0; k < 3; ++k) masks[c][k] = _mm_load_si128(reinterpret_cast<const __m128i *>(BGR_MASKS.mask[c][k]));
+	}
+	auto zero = _mm_setzero_si128();
+	auto x = 0;
+	for (; x + 16 <= width; x += 16) {
+		// channels of both rows, as 8 bit lanes, then widened to 16 bits in two halves
+		__m128i lo[2][3], hi[2][3];
+		const unsigned char *rows[2] = {top, bottom};
+		unsigned char *luma[2] = {y_top, y_bottom};
+		for (auto row = 0; row < 2; ++row) {
+			auto p = rows[row] + 3 * x;
+			__m128i chunk[3];
+			for (auto k = 0; k < 3; ++k) chunk[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+			for (auto c = 0; c < 3; ++c) {
+				auto v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(chunk[0], masks[c][0]), _mm_shuffle_epi8(chunk[1], masks[c][1])), _mm_shuffle_epi8(chunk[2], masks[c][2]));
+				lo[row][c] = _mm_unpacklo_epi8(v, zero);
+				hi[row][c] = _mm_unpackhi_epi8(v, zero);
+			}
+			auto y_lo = YUV_LUMA(_mm, lo[row][2], lo[row][1], lo[row][0]);
+			auto y_hi = YUV_LUMA(_mm, hi[row][2], hi[row][1], hi[row][0]);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(luma[row] + x), _mm_packus_epi16(y_lo, y_hi));
+		}
+		// 2 x 2 sums: the rows added, then neighboring columns
+		__m128i avg[3];
+		for (auto c = 0; c < 3; ++c) {
+			auto sum = _mm_hadd_epi16(_mm_add_epi16(lo[0][c], lo[1][c]), _mm_add_epi16(hi[0][c], hi[1][c]));
+			avg[c] = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		}
+		auto u = YUV_CHROMA(_mm, avg[2], avg[1], avg[0], -38, -74, 112);
+		auto v = YUV_CHROMA(_mm, avg[2], avg[1], avg[0], 112, -94, -18);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(cb + x / 2), _mm_packus_epi16(u, u));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(cr + x / 2), _mm_packus_epi16(v, v));
+	}
+	return x;
+}
+
+// the same 32 pixels at a time: each 128 bit lane works on 16 of them exactly as above
+__attribute__((target("avx2")))
+static int bgr_to_yuv420_avx2(const unsigned char *top, const unsigned char *bottom, int width, unsigned char *y_top, unsigned char *y_bottom, unsigned char *cb, unsigned char *cr) {
+	__m256i masks[3][3];
+	for (auto c = 0; c < 3; ++c) {
+		for (auto k = 0; k < 3; ++k) masks[c][k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(BGR_MASKS.mask[c][k])));
+	}
+	auto zero = _mm256_setzero_si256();
+	auto x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i lo[2][3], hi[2][3];
+		const unsigned char *rows[2] = {top, bottom};
+		unsigned char *luma[2] = {y_top, y_bottom};
+		for (auto row = 0; row < 2; ++row) {
+			auto p = rows[row] + 3 * x;
+			__m256i chunk[3];
+			// pixels 0 to 15 in the low lane, 16 to 31 in the high one
+			for (auto k = 0; k < 3; ++k) {
+				chunk[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k))),
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 48 + 16 * k)), 1);
+			}
+			for (auto c = 0; c < 3; ++c) {
+				auto v = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(chunk[0], masks[c][0]), _mm256_shuffle_epi8(chunk[1], masks[c][1])), _mm256_shuffle_epi8(chunk[2], masks[c][2]));
+				lo[row][c] = _mm256_unpacklo_epi8(v, zero);
+				hi[row][c] = _mm256_unpackhi_epi8(v, zero);
+			}
+			auto y_lo = YUV_LUMA(_mm256, lo[row][2], lo[row][1], lo[row][0]);
+			auto y_hi = YUV_LUMA(_mm256, hi[row][2], hi[row][1], hi[row][0]);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(luma[row] + x), _mm256_packus_epi16(y_lo, y_hi));
+		}
+		__m256i avg[3];
+		for (auto c = 0; c < 3; ++c) {
+			auto sum = _mm256_hadd_epi16(_mm256_add_epi16(lo[0][c], lo[1][c]), _mm256_add_epi16(hi[0][c], hi[1][c]));
+			avg[c] = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+		}
+		auto u = YUV_CHROMA(_mm256, avg[2], avg[1], avg[0], -38, -74, 112);
+		auto v = YUV_CHROMA(_mm256, avg[2], avg[1], avg[0], 112, -94, -18);
+		// each lane packed its 8 into its low half, bring the two halves together
+		auto u8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(u, u), 0x08);
+		auto v8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(cb + x / 2), _mm256_castsi256_si128(u8));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(cr + x / 2), _mm256_castsi256_si128(v8));
+	}
+	return x;
+}
+
+#undef YUV_LUMA
+#undef YUV_CHROMA
+
+#endif //RENDERER_X86_SIMD
+
+void bgr_to_yuv420(RasterIsa isa, const unsigned char *top, const unsigned char *bottom, int width, unsigned char *y_top, unsigned char *y_bottom, unsigned char *cb, unsigned char *cr) {
+	auto done = 0;
+#ifdef RENDERER_X86_SIMD
+	if (isa == RASTER_AVX2) done = bgr_to_yuv420_avx2(top, bottom, width, y_top, y_bottom, cb, cr);
+	else if (isa == RASTER_SSE41) done = bgr_to_yuv420_sse41(top, bottom, width, y_top, y_bottom, cb, cr);
+#endif
+	bgr_to_yuv420_scalar(done, top, bottom, width, y_top, y_bottom, cb, cr);
+}
@@ -0,0 +1,26 @@
+#ifndef __YUV_H__
+#define __YUV_H__
+
+#include "raster_simd.h"
+
+// bt.601 y'cbcr in "tv" range (luma 16 to 235, chroma 16 to 240), what video encoders take by
+// default. integer only, in 8.8 fixed point, so every isa gives the same bytes
+inline unsigned char rgb_to_y(int r, int g, int b) {
+	return static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline unsigned char rgb_to_cb(int r, int g, int b) {
+	return static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline unsigned char rgb_to_cr(int r, int g, int b) {
+	return static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// convert two rows of width bgr pixels, top above bottom, to 4:2:0: a row of luma for each, and
+// one row of (width + 1) / 2 cb and cr between them, each from the rounded average color of a
+// 2 x 2 block (the last column, on odd widths, only has itself to average with). 16 or 32
+// pixels at a time on whatever isa allows. bottom may be top, for the last row of an odd height
+void bgr_to_yuv420(RasterIsa isa, const unsigned char *top, const unsigned char *bottom, int width, unsigned char *y_top, unsigned char *y_bottom, unsigned char *cb, unsigned char *cr);
+
+#endif //__YUV_H__
@@ -0,0 +1,93 @@
+/**
+ * checks that rendering a frame a band of rows at a time writes exactly the file rendering it
+ * whole and writing that does: bands of one row, of sizes that don't divide the image or its
+ * tiles, and of the whole image, in every format a band can be streamed as, for both depth
+ * formats and a couple of views.
+ * usage: banded_equivalence model.obj texture.tga
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "banded.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "image_formats.h"
+#include "model.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "texture.h"
+#include "tgaimage.h"
+#include "thread_pool.h"
+
+// odd sizes, so bands and tiles don't split evenly
+const int WIDTH = 301;
+const int HEIGHT = 217;
+
+static std::vector<unsigned char> read_file(const char *filename) {
+	std::ifstream in(filename, std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		std::cerr << "usage: " << argv[0] << " model.obj texture.tga\n";
+		return 1;
+	}
+	ThreadPool pool(4);
+	Model model(argv[1], &pool);
+	TGAImage diffuse;
+	if (model.nfaces() == 0 || !diffuse.read_tga_file(argv[2])) {
+		std::cerr << "can't load " << argv[1] << " and " << argv[2] << "\n";
+		return 1;
+	}
+	diffuse.flip_vertically();
+	Texture texture(diffuse, FILTER_BILINEAR, WRAP_REPEAT);
+	auto background = TGAColor(200, 200, 200, 255);
+	auto towards_light = Vec3f(3, 0, 1).normalize();
+	auto options = RasterOptions{detect_raster_isa(), true, false, true};
+
+	// straight on, and from above off to one side, close enough that the head fills the frame
+	Camera cameras[2];
+	cameras[1].look_at(Vec3f(1.5f, 1, 1.5f), Vec3f(0, 0, 0));
+	cameras[1].set_perspective(60, 0.5f, 10);
+
+	const char *whole_file = "banded_equivalence_whole";
+	const char *banded_file = "banded_equivalence_banded";
+	auto failures = 0;
+	auto renders = 0;
+	for (auto &camera : cameras) {
+		for (auto format : {DEPTH_FLOAT32, DEPTH_UNORM24}) {
+			RenderStats stats;
+			Framebuffer whole(WIDTH, HEIGHT, TILE_SIZE, format);
+			whole.clear(background);
+			draw_scene(SHADE_TEXTURED_PHONG, model, camera, texture, towards_light, whole, pool, options, stats);
+			whole.resolve();
+
+			for (auto image_format : {IMAGE_TGA, IMAGE_QOI, IMAGE_PPM, IMAGE_PAM}) {
+				if (!write_image(whole_file, image_format, whole.get_image(), true, &pool)) return 1;
+				auto expected = read_file(whole_file);
+
+				for (auto band_rows : {1, 7, 64, 100, HEIGHT}) {
+					++renders;
+					ImageStream out;
+					auto ok = out.open(banded_file, image_format, WIDTH, HEIGHT, TGAImage::RGB, &pool) &&
+						render_banded(SHADE_TEXTURED_PHONG, model, camera, texture, towards_light, background, WIDTH, HEIGHT, band_rows, format, pool, options, out, stats) &&
+						out.close();
+					if (ok && read_file(banded_file) == expected) continue;
+					if (++failures <= 20) {
+						std::cout << (&camera == cameras ? "front" : "above") << " view, " << depth_format_name(format) << " depth, " << image_format_name(image_format)
+							<< " in bands of " << band_rows << ": " << (ok ? "the file differs" : "didn't render") << "\n";
+					}
+				}
+			}
+		}
+	}
+	remove(whole_file);
+	remove(banded_file);
+	std::cout << renders << " banded renders, " << failures << " different from rendering whole\n";
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * checks that an .obj big enough to be parsed in chunks on a thread pool loads exactly as it does
+ * in one piece, and as written: faces as v, v/vt, v//vn and v/vt/vn, with positive and negative
+ * (relative) indices reaching back into earlier chunks, quads to fan out, and lines ending in
+ * \r\n. the file is generated, along with the mesh it should load as
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "obj_loader.h"
+#include "thread_pool.h"
+
+// comfortably over the size the loader starts splitting files at
+const size_t FILE_BYTES = 3 << 20;
+
+// write an .obj of about FILE_BYTES to filename, and the mesh it holds to expected
+static bool write_obj(const char *filename, MeshData &expected) {
+	std::mt19937 random(1234);
+	auto pick = [&](int n) {
+		return static_cast<int>(random() % n);
+	};
+	// quarters, which the file holds exactly
+	auto value = [&]() {
+		return (pick(8000) - 4000) * 0.25f;
+	};
+	std::ostringstream obj;
+	obj.setf(std::ios::fixed);
+	obj.precision(2);
+	while (obj.tellp() < static_cast<std::streamoff>(FILE_BYTES)) {
+		auto eol = pick(10) == 0 ? "\r\n" : "\n";
+		auto kind = pick(10);
+		if (kind < 3 || expected.vx.empty()) {
+			float v[3] = {value(), value(), value()};
+			obj << "v " << v[0] << " " << v[1] << " " << v[2] << eol;
+			expected.vx.push_back(v[0]);
+			expected.vy.push_back(v[1]);
+			expected.vz.push_back(v[2]);
+		} else if (kind < 5 || expected.tu.empty()) {
+			float t[2] = {value(), value()};
+			obj << "vt " << t[0] << " " << t[1] << eol;
+			expected.tu.push_back(t[0]);
+			expected.tv.push_back(t[1]);
+		} else if (kind < 7 || expected.nx.empty()) {
+			float n[3] = {value(), value(), value()};
+			obj << "vn " << n[0] << " " << n[1] << " " << n[2] << eol;
+			expected.nx.push_back(n[0]);
+			expected.ny.push_back(n[1]);
+			expected.nz.push_back(n[2]);
+		} else {
+			// a triangle or a quad, every corner in the same style. indices mostly point at the
+			// last few of each attribute, which near the start of a chunk are in the one before
+			auto style = pick(4); // v, v/vt, v//vn, v/vt/vn
+			auto corners = 3 + pick(2);
+			int v[4], vt[4], vn[4];
+			obj << "f";
+			for (auto k = 0; k < corners; ++k) {
+				auto index = [&](int count, bool wanted, int &out) {
+					if (!wanted) {
+						out = -1;
+						return std::string();
+					}
+					out = pick(4) ? count - 1 - pick(std::min(count, 40)) : pick(count);
+					return std::to_string(pick(2) ? out - count : out + 1);
+				};
+				auto sv = index(static_cast<int>(expected.vx.size()), true, v[k]);
+				auto st = index(static_cast<int>(expected.tu.size()), style == 1 || style == 3, vt[k]);
+				auto sn = index(static_cast<int>(expected.nx.size()), style >= 2, vn[k]);
+				obj << " " << sv;
+				if (style == 1) obj << "/" << st;
+				if (style == 2) obj << "//" << sn;
+				if (style == 3) obj << "/" << st << "/" << sn;
+			}
+			obj << eol;
+			for (auto i = 1; i + 1 < corners; ++i) {
+				for (auto k : {0, i, i + 1}) {
+					expected.vfaces.push_back(v[k]);
+					expected.vtfaces.push_back(vt[k]);
+					expected.vnfaces.push_back(vn[k]);
+				}
+			}
+		}
+	}
+	std::ofstream out(filename, std::ios::binary);
+	out << obj.str();
+	return out.good();
+}
+
+// the first difference between two meshes, or ""
+static std::string compare(const MeshData &expected, const MeshData &got) {
+	const std::vector<float> MeshData::*floats[] = {&MeshData::vx, &MeshData::vy, &MeshData::vz, &MeshData::tu, &MeshData::tv, &MeshData::nx, &MeshData::ny, &MeshData::nz};
+	const char *float_names[] = {"vx", "vy", "vz", "tu", "tv", "nx", "ny", "nz"};
+	const std::vector<int> MeshData::*ints[] = {&MeshData::vfaces, &MeshData::vtfaces, &MeshData::vnfaces};
+	const char *int_names[] = {"vfaces", "vtfaces", "vnfaces"};
+	std::ostringstream out;
+	for (auto i = 0; i < 8; ++i) {
+		auto &e = expected.*floats[i];
+		auto &g = got.*floats[i];
+		for (size_t k = 0; k < e.size() && k < g.size(); ++k) {
+			if (e[k] != g[k]) {
+				out << float_names[i] << "[" << k << "] is " << g[k] << " not " << e[k];
+				return out.str();
+			}
+		}
+		if (e.size() != g.size()) {
+			out << g.size() << " " << float_names[i] << ", not " << e.size();
+			return out.str();
+		}
+	}
+	for (auto i = 0; i < 3; ++i) {
+		auto &e = expected.*ints[i];
+		auto &g = got.*ints[i];
+		for (size_t k = 0; k < e.size() && k < g.size(); ++k) {
+			if (e[k] != g[k]) {
+				out << int_names[i] << "[" << k << "] (triangle " << k / 3 << ") is " << g[k] << " not " << e[k];
+				return out.str();
+			}
+		}
+		if (e.size() != g.size()) {
+			out << g.size() << " " << int_names[i] << ", not " << e.size();
+			return out.str();
+		}
+	}
+	return std::string();
+}
+
+int main() {
+	const char *filename = "obj_chunks.obj";
+	MeshData expected;
+	if (!write_obj(filename, expected)) {
+		std::cout << "can't write " << filename << "\n";
+		return 1;
+	}
+
+	ThreadPool pool(4);
+	auto failures = 0;
+	for (auto chunked : {false, true}) {
+		MeshData mesh;
+		auto error = load_obj(filename, mesh, chunked ? &pool : nullptr) ? compare(expected, mesh) : "didn't load";
+		if (error.empty()) continue;
+		++failures;
+		std::cout << (chunked ? "in chunks: " : "in one piece: ") << error << "\n";
+	}
+	remove(filename);
+
+	std::cout << expected.vx.size() << " vertices and " << expected.vfaces.size() / 3 << " triangles loaded in one piece and in chunks, " << failures << " wrong\n";
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * checks that qoi files decode back to exactly the pixels encoded, with a decoder written here
+ * from the spec rather than sharing anything with the encoder: grayscale, bgr and bgra, top-down
+ * and bottom-up, images that use every chunk (runs past the 62 one chunk holds, index hits,
+ * small and luma differences, alpha changes), and the same file encoded a few rows at a time
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "image_formats.h"
+
+struct Image {
+	int width, height, bytespp;
+	std::vector<unsigned char> pixels; // row 0 at the top
+	std::string kind;
+};
+
+static uint32_t get_u32_be(const unsigned char *p) {
+	return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+// decode a whole qoi file into rgba pixels, top row first. false if it isn't one
+static bool qoi_decode(const std::vector<unsigned char> &file, int &width, int &height, int &channels, std::vector<unsigned char> &rgba) {
+	if (file.size() < 14 + 8 || memcmp(file.data(), "qoif", 4)) return false;
+	width = static_cast<int>(get_u32_be(&file[4]));
+	height = static_cast<int>(get_u32_be(&file[8]));
+	channels = file[12];
+	size_t npixels = static_cast<size_t>(width) * height;
+	rgba.assign(npixels * 4, 0);
+	unsigned char index[64][4] = {};
+	unsigned char px[4] = {0, 0, 0, 255};
+	size_t pos = 14, end = file.size() - 8;
+	for (size_t p = 0; p < npixels; ++p) {
+		if (pos >= end) return false;
+		auto tag = file[pos++];
+		if (tag == 0xfe || tag == 0xff) {
+			if (pos + (tag == 0xff ? 4 : 3) > end) return false;
+			px[0] = file[pos++];
+			px[1] = file[pos++];
+			px[2] = file[pos++];
+			if (tag == 0xff) px[3] = file[pos++];
+		} else if ((tag & 0xc0) == 0x00) {
+			memcpy(px, index[tag], 4);
+		} else if ((tag & 0xc0) == 0x40) {
+			px[0] = static_cast<unsigned char>(px[0] + ((tag >> 4) & 3) - 2);
+			px[1] = static_cast<unsigned char>(px[1] + ((tag >> 2) & 3) - 2);
+			px[2] = static_cast<unsigned char>(px[2] + (tag & 3) - 2);
+		} else if ((tag & 0xc0) == 0x80) {
+			if (pos >= end) return false;
+			auto dg = (tag & 0x3f) - 32;
+			auto next = file[pos++];
+			px[0] = static_cast<unsigned char>(px[0] + dg + (next >> 4) - 8);
+			px[1] = static_cast<unsigned char>(px[1] + dg);
+			px[2] = static_cast<unsigned char>(px[2] + dg + (next & 15) - 8);
+		} else {
+			// a run repeats the previous pixel, this one included
+			auto run = (tag & 0x3f) + 1;
+			if (p + run > npixels) return false;
+			for (auto i = 0; i < run; ++i) memcpy(&rgba[(p + i) * 4], px, 4);
+			p += run - 1;
+			continue;
+		}
+		memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+		memcpy(&rgba[p * 4], px, 4);
+	}
+	static const unsigned char END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	return pos == end && !memcmp(&file[end], END_MARKER, 8);
+}
+
+// the first thing wrong with file as image's encoding, or ""
+static std::string check(const Image &image, const std::vector<unsigned char> &file) {
+	std::ostringstream out;
+	int width, height, channels;
+	std::vector<unsigned char> rgba;
+	if (!qoi_decode(file, width, height, channels, rgba)) return "it doesn't decode";
+	if (width != image.width || height != image.height) return "its size is wrong";
+	if (channels != (image.bytespp == 4 ? 4 : 3)) return "its channel count is wrong";
+	for (auto p = 0; p < width * height; ++p) {
+		auto s = &image.pixels[static_cast<size_t>(p) * image.bytespp];
+		unsigned char expected[4] = {s[0], s[0], s[0], 255};
+		if (image.bytespp > 1) {
+			expected[0] = s[2];
+			expected[1] = s[1];
+			expected[2] = s[0];
+			if (image.bytespp == 4) expected[3] = s[3];
+		}
+		if (memcmp(&rgba[static_cast<size_t>(p) * 4], expected, 4)) {
+			out << "pixel " << p % width << "," << p / width << " differs";
+			return out.str();
+		}
+	}
+	return std::string();
+}
+
+// the rows of image bottom to top, as a framebuffer holds them
+static std::vector<unsigned char> flipped(const Image &image) {
+	auto row_bytes = static_cast<size_t>(image.width) * image.bytespp;
+	std::vector<unsigned char> rows(image.pixels.size());
+	for (auto y = 0; y < image.height; ++y) {
+		memcpy(&rows[(image.height - 1 - y) * row_bytes], &image.pixels[y * row_bytes], row_bytes);
+	}
+	return rows;
+}
+
+static std::vector<Image> test_images() {
+	std::mt19937 random(1234);
+	auto uniform = [&](int n) {
+		return static_cast<int>(random() % n);
+	};
+	std::vector<Image> images;
+	for (auto bpp : {1, 3, 4}) {
+		for (auto width : {1, 5, 64, 131}) {
+			auto height = 9;
+			auto size = static_cast<size_t>(width) * height * bpp;
+
+			Image noise{width, height, bpp, std::vector<unsigned char>(size), "noise"};
+			for (auto &b : noise.pixels) b = static_cast<unsigned char>(random());
+			images.push_back(noise);
+
+			// one color, so runs go on past the 62 pixels a run chunk holds
+			images.push_back(Image{width, height, bpp, std::vector<unsigned char>(size, 200), "flat"});
+
+			// small steps from pixel to pixel, for diff and luma chunks (wrapping round 0 and 255),
+			// back to colors seen before for index chunks, and an alpha that changes now and then
+			Image smooth{width, height, bpp, std::vector<unsigned char>(size), "smooth"};
+			int c[4] = {0, 128, 255, 255};
+			for (size_t p = 0; p < size; p += bpp) {
+				auto step = uniform(4);
+				for (auto t = 0; t < 3; ++t) c[t] = (c[t] + (step == 0 ? uniform(4) - 2 : step == 1 ? uniform(40) - 20 : step == 2 ? 0 : uniform(256))) & 255;
+				if (uniform(30) == 0) c[3] = uniform(256);
+				if (uniform(10) == 0) c[0] = c[1] = c[2] = 7 * uniform(3);
+				for (auto t = 0; t < bpp; ++t) smooth.pixels[p + t] = static_cast<unsigned char>(c[t]);
+			}
+			images.push_back(smooth);
+		}
+	}
+	return images;
+}
+
+int main() {
+	auto failures = 0;
+	auto checked = 0;
+	for (auto &image : test_images()) {
+		auto name = image.kind + " " + std::to_string(image.width) + "x" + std::to_string(image.height) + " of " + std::to_string(image.bytespp) + " bytes";
+		auto bottom_up = flipped(image);
+
+		std::vector<unsigned char> top_down_file, bottom_up_file, piecewise_file;
+		qoi_encode(image.pixels.data(), image.width, image.height, image.bytespp, false, top_down_file);
+		qoi_encode(bottom_up.data(), image.width, image.height, image.bytespp, true, bottom_up_file);
+		// blocks of rows from the top, each bottom-up on its own like a band of a framebuffer
+		QoiState state;
+		qoi_encode_header(image.width, image.height, image.bytespp, piecewise_file);
+		auto row_bytes = static_cast<size_t>(image.width) * image.bytespp;
+		for (auto y = 0; y < image.height; y += 4) {
+			auto rows = std::min(4, image.height - y);
+			Image block{image.width, rows, image.bytespp, std::vector<unsigned char>(&image.pixels[y * row_bytes], &image.pixels[(y + rows) * row_bytes]), ""};
+			auto block_rows = flipped(block);
+			qoi_encode_rows(block_rows.data(), image.width, rows, image.bytespp, true, state, piecewise_file);
+		}
+		qoi_encode_end(state, piecewise_file);
+
+		std::string errors[] = {check(image, top_down_file), check(image, bottom_up_file), piecewise_file == top_down_file ? "" : "it differs from the whole file"};
+		const char *ways[] = {"top-down", "bottom-up", "a few rows at a time"};
+		for (auto i = 0; i < 3; ++i) {
+			++checked;
+			if (errors[i].empty()) continue;
+			if (++failures <= 20) std::cout << name << ", " << ways[i] << ": " << errors[i] << "\n";
+		}
+	}
+	std::cout << checked << " encodings checked, " << failures << " wrong\n";
+	return failures ? 1 : 0;
+}
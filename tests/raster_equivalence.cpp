@@ -0,0 +1,198 @@
+/**
+ * checks that every pixel kernel this cpu can run draws exactly what the scalar one does: the
+ * same depth buffer, and the same fragments in the same order with bit-identical weights. random
+ * triangles plus the cases most likely to go wrong: edges on pixel centers (the top-left rule),
+ * slivers, triangles reaching far off screen, and rows that end partway through a SIMD group
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "framebuffer.h"
+#include "raster_simd.h"
+#include "rasterizer.h"
+
+// odd sizes, so rows end partway through a group of 4 or 8
+const int WIDTH = 109;
+const int HEIGHT = 67;
+// how many screens past each edge the biggest triangles reach
+const float FAR_OUT = 8;
+
+struct Triangle {
+	Vec3f a, b, c;
+	Vec3f z;
+	std::string kind;
+};
+
+struct Fragment {
+	int x, y;
+	uint32_t w[3]; // the weights' bits
+	bool operator!=(const Fragment &f) const {
+		return x != f.x || y != f.y || memcmp(w, f.w, sizeof(w));
+	}
+};
+
+// what one kernel drew
+struct Drawn {
+	std::vector<uint32_t> depth;
+	std::vector<Fragment> fragments;
+	long long tested;
+};
+
+static Drawn draw(RasterIsa isa, bool reference, const TriangleSetup &t, const Rect &clip, Vec3f z, DepthFormat format, const std::vector<uint32_t> &start) {
+	Drawn drawn;
+	drawn.depth = start;
+	drawn.tested = 0;
+	auto shade = [&](int x, int y, Vec3f weights) {
+		Fragment f;
+		f.x = x;
+		f.y = y;
+		memcpy(&f.w[0], &weights.x, sizeof(float));
+		memcpy(&f.w[1], &weights.y, sizeof(float));
+		memcpy(&f.w[2], &weights.z, sizeof(float));
+		drawn.fragments.push_back(f);
+	};
+	if (reference) {
+		rasterize_depth_tested_scalar(t, clip, z, drawn.depth.data(), WIDTH, format, drawn.tested, shade);
+	} else {
+		rasterize_depth_tested(isa, t, clip, z, drawn.depth.data(), WIDTH, format, drawn.tested, shade);
+	}
+	return drawn;
+}
+
+// the first difference between what the scalar kernel and another drew, or ""
+static std::string compare(const Drawn &expected, const Drawn &got) {
+	std::ostringstream out;
+	for (size_t i = 0; i < expected.fragments.size() && i < got.fragments.size(); ++i) {
+		auto &e = expected.fragments[i];
+		auto &g = got.fragments[i];
+		if (e != g) {
+			out << "fragment " << i << " is at " << g.x << "," << g.y << " not " << e.x << "," << e.y << ", or its weights differ";
+			return out.str();
+		}
+	}
+	if (expected.fragments.size() != got.fragments.size()) {
+		out << got.fragments.size() << " fragments, not " << expected.fragments.size();
+		return out.str();
+	}
+	for (size_t p = 0; p < expected.depth.size(); ++p) {
+		if (expected.depth[p] != got.depth[p]) {
+			out << "depth at " << p % WIDTH << "," << p / WIDTH << " is " << got.depth[p] << " not " << expected.depth[p];
+			return out.str();
+		}
+	}
+	if (expected.tested != got.tested) {
+		out << got.tested << " pixels tested, not " << expected.tested;
+		return out.str();
+	}
+	return std::string();
+}
+
+static std::vector<Triangle> test_triangles() {
+	std::mt19937 random(1234);
+	auto uniform = [&](float lo, float hi) {
+		return std::uniform_real_distribution<float>(lo, hi)(random);
+	};
+	auto depths = [&]() {
+		return Vec3f(uniform(0, 1), uniform(0, 1), uniform(0, 1));
+	};
+	auto on_grid = [&](float lo, float hi) {
+		return std::floor(uniform(lo, hi));
+	};
+	std::vector<Triangle> triangles;
+
+	// anywhere on screen and a little off it
+	for (auto i = 0; i < 400; ++i) {
+		triangles.push_back({Vec3f(uniform(-10, WIDTH + 10), uniform(-10, HEIGHT + 10), 0), Vec3f(uniform(-10, WIDTH + 10), uniform(-10, HEIGHT + 10), 0),
+			Vec3f(uniform(-10, WIDTH + 10), uniform(-10, HEIGHT + 10), 0), depths(), "random"});
+	}
+	// small ones, a few pixels or less across
+	for (auto i = 0; i < 400; ++i) {
+		auto x = uniform(0, WIDTH), y = uniform(0, HEIGHT);
+		triangles.push_back({Vec3f(x, y, 0), Vec3f(x + uniform(-3, 3), y + uniform(-3, 3), 0), Vec3f(x + uniform(-3, 3), y + uniform(-3, 3), 0), depths(), "small"});
+	}
+	// vertices on pixel centers, so whole edges run through them: quads split both ways, each
+	// pair sharing an edge, and axis-aligned right triangles with top, left, bottom and right edges
+	for (auto i = 0; i < 200; ++i) {
+		auto x0 = on_grid(-4, WIDTH), y0 = on_grid(-4, HEIGHT);
+		auto x1 = x0 + on_grid(1, 24), y1 = y0 + on_grid(1, 24);
+		auto z = depths();
+		Vec3f p[4] = {Vec3f(x0, y0, 0), Vec3f(x1, y0, 0), Vec3f(x1, y1, 0), Vec3f(x0, y1, 0)};
+		triangles.push_back({p[0], p[1], p[2], z, "top-left"});
+		triangles.push_back({p[0], p[2], p[3], z, "top-left"});
+		triangles.push_back({p[1], p[3], p[0], z, "top-left"});
+		triangles.push_back({p[1], p[2], p[3], z, "top-left"});
+		triangles.push_back({Vec3f(on_grid(0, WIDTH), on_grid(0, HEIGHT), 0), Vec3f(on_grid(0, WIDTH), on_grid(0, HEIGHT), 0), Vec3f(on_grid(0, WIDTH), on_grid(0, HEIGHT), 0), z, "on grid"});
+	}
+	// slivers: the third vertex a sub-pixel step off the line through the first two
+	for (auto i = 0; i < 300; ++i) {
+		auto a = Vec3f(uniform(-20, WIDTH + 20), uniform(-20, HEIGHT + 20), 0);
+		auto b = Vec3f(uniform(-20, WIDTH + 20), uniform(-20, HEIGHT + 20), 0);
+		auto s = uniform(0, 1);
+		auto c = a + (b - a) * s + Vec3f(uniform(-1, 1), uniform(-1, 1), 0) * (1.0f / SUBPIXEL_ONE);
+		triangles.push_back({a, b, c, depths(), "sliver"});
+	}
+	// far off screen, where edge values grow too big for 32 bits and kernels fall back
+	auto gx = FAR_OUT * WIDTH, gy = FAR_OUT * HEIGHT;
+	for (auto i = 0; i < 200; ++i) {
+		triangles.push_back({Vec3f(uniform(-gx, WIDTH + gx), uniform(-gy, HEIGHT + gy), 0), Vec3f(uniform(-gx, WIDTH + gx), uniform(-gy, HEIGHT + gy), 0),
+			Vec3f(uniform(0, WIDTH), uniform(0, HEIGHT), 0), depths(), "far out"});
+	}
+	triangles.push_back({Vec3f(-gx, -gy, 0), Vec3f(WIDTH + gx, -gy, 0), Vec3f(-gx, HEIGHT + gy, 0), Vec3f(0.5f, 0.25f, 1), "far out corners"});
+	triangles.push_back({Vec3f(WIDTH + gx, HEIGHT + gy, 0), Vec3f(-gx, HEIGHT + gy, 0), Vec3f(WIDTH + gx, -gy, 0), Vec3f(0, 1, 0.75f), "far out corners"});
+	return triangles;
+}
+
+int main() {
+	std::vector<RasterIsa> kernels;
+#ifdef RENDERER_X86_SIMD
+	auto best = detect_raster_isa();
+	for (auto isa : {RASTER_SSE41, RASTER_AVX2}) {
+		if (isa <= best) kernels.push_back(isa);
+	}
+#endif
+	if (kernels.empty()) {
+		std::cout << "no SIMD kernels to check on this cpu\n";
+		return 0;
+	}
+
+	auto triangles = test_triangles();
+	// the whole screen, and a tile-like rectangle that cuts most triangles short
+	Rect clips[] = {Rect(0, 0, WIDTH, HEIGHT), Rect(13, 7, 13 + 37, 7 + 29)};
+	std::mt19937 random(99);
+	auto failures = 0;
+	auto drawn = 0;
+	for (auto format : {DEPTH_FLOAT32, DEPTH_UNORM24}) {
+		// a depth buffer with something in it, so the z test passes some pixels and fails others
+		std::vector<uint32_t> start(static_cast<size_t>(WIDTH) * HEIGHT);
+		for (auto &d : start) d = encode_depth(std::uniform_real_distribution<float>(0, 1)(random), format);
+
+		for (size_t i = 0; i < triangles.size(); ++i) {
+			auto &tri = triangles[i];
+			TriangleSetup t;
+			if (!setup_triangle(tri.a, tri.b, tri.c, t)) continue;
+			for (auto &clip : clips) {
+				++drawn;
+				auto expected = draw(RASTER_SCALAR, true, t, clip, tri.z, format, start);
+				for (auto isa : kernels) {
+					auto error = compare(expected, draw(isa, false, t, clip, tri.z, format, start));
+					if (error.empty()) continue;
+					if (++failures <= 20) {
+						std::cout << raster_isa_name(isa) << ", " << depth_format_name(format) << " depth, " << tri.kind << " triangle " << i
+							<< " (" << tri.a.x << "," << tri.a.y << " " << tri.b.x << "," << tri.b.y << " " << tri.c.x << "," << tri.c.y << "): " << error << "\n";
+					}
+				}
+			}
+		}
+	}
+
+	std::cout << drawn << " triangles drawn with";
+	for (auto isa : kernels) std::cout << " " << raster_isa_name(isa);
+	std::cout << " against scalar, " << failures << " different\n";
+	return failures ? 1 : 0;
+}
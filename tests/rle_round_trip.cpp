@@ -0,0 +1,180 @@
+/**
+ * checks that tga rle decodes back to exactly what was encoded, for every pixel size: noise,
+ * flat images whose runs go on past the end of each row, runs around the length worth breaking
+ * a literal packet for, runs longer than a packet holds, and images big enough to be encoded in
+ * bands on a thread pool. also that no packet crosses a row, and that packets from other writers
+ * that do cross rows decode
+ */
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "tga_rle.h"
+#include "thread_pool.h"
+
+struct Image {
+	int width, height, bytespp;
+	std::vector<unsigned char> pixels;
+	std::string kind;
+};
+
+// the first thing wrong with encoding image (on pool, if given), or ""
+static std::string round_trip(const Image &image, ThreadPool *pool) {
+	std::ostringstream out;
+	std::vector<unsigned char> encoded;
+	rle_encode(image.pixels.data(), image.width, image.height, image.bytespp, encoded, pool);
+
+	// walk the packets, none of which should run past the end of a row
+	size_t pixel = 0;
+	for (size_t i = 0; i < encoded.size();) {
+		auto header = encoded[i];
+		size_t count = (header & 0x7f) + 1;
+		if (pixel / image.width != (pixel + count - 1) / image.width) {
+			out << "the packet at byte " << i << " crosses the end of row " << pixel / image.width;
+			return out.str();
+		}
+		pixel += count;
+		i += 1 + (header < 0x80 ? count : 1) * image.bytespp;
+	}
+
+	std::vector<unsigned char> decoded(image.pixels.size() + 1, 0xcd);
+	auto end = encoded.data() + encoded.size();
+	auto stop = rle_decode(encoded.data(), end, decoded.data(), static_cast<size_t>(image.width) * image.height, image.bytespp);
+	if (stop != end) {
+		out << (stop ? "decoding stopped short of the end" : "decoding failed");
+		return out.str();
+	}
+	if (decoded.back() != 0xcd) return "decoding wrote past the image";
+	for (size_t b = 0; b < image.pixels.size(); ++b) {
+		if (decoded[b] != image.pixels[b]) {
+			auto p = b / image.bytespp;
+			out << "pixel " << p % image.width << "," << p / image.width << " differs";
+			return out.str();
+		}
+	}
+	return std::string();
+}
+
+static std::vector<Image> test_images() {
+	std::mt19937 random(1234);
+	auto byte = [&]() {
+		return static_cast<unsigned char>(random());
+	};
+	std::vector<Image> images;
+	for (auto bpp = 1; bpp <= 4; ++bpp) {
+		// odd widths, so rows end partway through the 16 bytes the encoder compares at a time
+		for (auto width : {1, 2, 3, 17, 127, 128, 129, 300}) {
+			auto height = 7;
+			auto size = static_cast<size_t>(width) * height * bpp;
+			Image noise{width, height, bpp, std::vector<unsigned char>(size), "noise"};
+			for (auto &b : noise.pixels) b = byte();
+			images.push_back(noise);
+
+			// one color throughout, so every row is one run that would go on into the next
+			Image flat{width, height, bpp, std::vector<unsigned char>(size), "flat"};
+			for (size_t p = 0; p < size; p += bpp) memset(&flat.pixels[p], 0x5a, bpp);
+			images.push_back(flat);
+
+			// runs of every length from 1 to 5 between unlike pixels, either side of the 2 (or 3,
+			// for grayscale) worth breaking a literal for, carried over from row to row
+			Image runs{width, height, bpp, std::vector<unsigned char>(size), "short runs"};
+			auto left = 0, length = 1;
+			unsigned char value = 0;
+			for (size_t p = 0; p < size; p += bpp) {
+				if (left == 0) {
+					left = length;
+					length = length % 5 + 1;
+					value += 37;
+				}
+				--left;
+				for (auto t = 0; t < bpp; ++t) runs.pixels[p + t] = static_cast<unsigned char>(value + t);
+			}
+			images.push_back(runs);
+
+			// a few colors, so there are runs of random lengths, some past a packet's 128 pixels
+			Image patches{width, height, bpp, std::vector<unsigned char>(size), "patches"};
+			for (size_t p = 0; p < size; p += bpp) {
+				auto color = random() % 50 == 0 || p == 0 ? static_cast<unsigned char>(random() % 3) : patches.pixels[p - bpp];
+				memset(&patches.pixels[p], color, bpp);
+			}
+			images.push_back(patches);
+		}
+	}
+	return images;
+}
+
+// a literal packet only gives way to a run when that's no bigger: for grayscale a pair stays in
+// the literal and a triple doesn't, with more bytes a pair is enough
+static std::string min_run_sizes() {
+	struct Case {
+		int bytespp;
+		std::vector<unsigned char> pixels;
+		size_t size;
+	};
+	Case cases[] = {
+		{1, {1, 2, 2, 3}, 5},          // one literal of 4
+		{1, {1, 2, 2, 2, 3}, 6},       // literal 1, run 3, literal 1
+		{3, {1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3}, 12} // literal 1, run 2, literal 1
+	};
+	std::ostringstream out;
+	for (auto &c : cases) {
+		std::vector<unsigned char> encoded;
+		auto width = static_cast<int>(c.pixels.size()) / c.bytespp;
+		rle_encode(c.pixels.data(), width, 1, c.bytespp, encoded);
+		if (encoded.size() != c.size) {
+			out << width << " pixels of " << c.bytespp << " bytes took " << encoded.size() << " bytes, not " << c.size << "\n";
+		}
+	}
+	return out.str();
+}
+
+// packets other writers make, running from one row into the next
+static std::string crossing_packets() {
+	// a 3 x 2 image: a run of 4 then a literal of 2
+	const unsigned char packets[] = {0x83, 7, 0x01, 8, 9};
+	const unsigned char expected[] = {7, 7, 7, 7, 8, 9};
+	unsigned char pixels[6];
+	auto end = packets + sizeof(packets);
+	if (rle_decode(packets, end, pixels, 6, 1) != end || memcmp(pixels, expected, sizeof(pixels))) {
+		return "packets crossing a row didn't decode\n";
+	}
+	return std::string();
+}
+
+int main() {
+	ThreadPool pool(4);
+	auto failures = 0;
+	auto checked = 0;
+	auto report = [&](const std::string &error) {
+		if (error.empty()) return;
+		if (++failures <= 20) std::cout << error;
+	};
+
+	for (auto &image : test_images()) {
+		++checked;
+		auto error = round_trip(image, nullptr);
+		if (!error.empty()) {
+			report(image.kind + " " + std::to_string(image.width) + "x" + std::to_string(image.height) + " of " + std::to_string(image.bytespp) + " bytes: " + error + "\n");
+		}
+	}
+	// tall enough to be split into bands, each encoded on its own
+	std::mt19937 random(99);
+	for (auto bpp = 1; bpp <= 4; ++bpp) {
+		++checked;
+		Image image{301, 257, bpp, std::vector<unsigned char>(static_cast<size_t>(301) * 257 * bpp), "banded"};
+		for (size_t p = 0; p < image.pixels.size(); p += bpp) {
+			auto color = random() % 20 == 0 || p == 0 ? static_cast<unsigned char>(random()) : image.pixels[p - bpp];
+			memset(&image.pixels[p], color, bpp);
+		}
+		auto error = round_trip(image, &pool);
+		if (!error.empty()) report("banded 301x257 of " + std::to_string(bpp) + " bytes: " + error + "\n");
+	}
+	report(min_run_sizes());
+	report(crossing_packets());
+
+	std::cout << checked << " images round tripped, " << failures << " problems\n";
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * checks that rendering a frame as shards and merging them gives exactly the image rendering it
+ * in one go does: split by rows and by geometry, into a few shard counts (more row shards than
+ * tiles, and shards with no triangles of their own), for both depth formats and a couple of views.
+ * usage: shard_merge model.obj texture.tga
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "framebuffer.h"
+#include "model.h"
+#include "pipeline.h"
+#include "shard.h"
+#include "stats.h"
+#include "texture.h"
+#include "tgaimage.h"
+#include "thread_pool.h"
+
+// odd sizes, so rows and tiles don't split evenly
+const int WIDTH = 301;
+const int HEIGHT = 217;
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		std::cerr << "usage: " << argv[0] << " model.obj texture.tga\n";
+		return 1;
+	}
+	ThreadPool pool(4);
+	Model model(argv[1], &pool);
+	TGAImage diffuse;
+	if (model.nfaces() == 0 || !diffuse.read_tga_file(argv[2])) {
+		std::cerr << "can't load " << argv[1] << " and " << argv[2] << "\n";
+		return 1;
+	}
+	diffuse.flip_vertically();
+	Texture texture(diffuse, FILTER_BILINEAR, WRAP_REPEAT);
+	auto background = TGAColor(200, 200, 200, 255);
+	auto towards_light = Vec3f(3, 0, 1).normalize();
+	auto options = RasterOptions{detect_raster_isa(), true, false, true};
+
+	// straight on, and from above off to one side, close enough that the head fills the frame
+	Camera cameras[2];
+	cameras[1].look_at(Vec3f(1.5f, 1, 1.5f), Vec3f(0, 0, 0));
+	cameras[1].set_perspective(60, 0.5f, 10);
+
+	auto failures = 0;
+	auto merged_count = 0;
+	for (auto &camera : cameras) {
+		for (auto format : {DEPTH_FLOAT32, DEPTH_UNORM24}) {
+			RenderStats stats;
+			Framebuffer whole(WIDTH, HEIGHT, TILE_SIZE, format);
+			whole.clear(background);
+			draw_scene(SHADE_TEXTURED_PHONG, model, camera, texture, towards_light, whole, pool, options, stats);
+			whole.resolve();
+			auto &expected = whole.get_image();
+
+			for (auto split : {SHARD_ROWS, SHARD_GEOMETRY}) {
+				for (auto count : {1, 2, 3, 7}) {
+					std::vector<std::string> files;
+					auto ok = true;
+					for (auto shard = 0; shard < count && ok; ++shard) {
+						files.push_back("shard_merge_" + std::to_string(shard) + ".rshard");
+						ok = render_shard(SHADE_TEXTURED_PHONG, model, camera, texture, towards_light, background, WIDTH, HEIGHT, format, pool, options, shard, count, split, 1,
+							files.back().c_str(), stats);
+					}
+					TGAImage merged;
+					ok = ok && merge_shards(files, merged);
+					for (auto &f : files) remove(f.c_str());
+					++merged_count;
+
+					std::string error;
+					if (!ok) {
+						error = "didn't render or merge";
+					} else if (merged.get_width() != WIDTH || merged.get_height() != HEIGHT || merged.get_bytespp() != expected.get_bytespp()) {
+						error = "the merged image is the wrong size";
+					} else {
+						auto bytes = static_cast<size_t>(WIDTH) * HEIGHT * expected.get_bytespp();
+						for (size_t b = 0; b < bytes && error.empty(); ++b) {
+							if (merged.buffer()[b] != expected.buffer()[b]) {
+								auto p = b / expected.get_bytespp();
+								error = "pixel " + std::to_string(p % WIDTH) + "," + std::to_string(p / WIDTH) + " differs";
+							}
+						}
+					}
+					if (error.empty()) continue;
+					if (++failures <= 20) {
+						std::cout << (&camera == cameras ? "front" : "above") << " view, " << depth_format_name(format) << " depth, " << count << " "
+							<< shard_split_name(split) << " shards: " << error << "\n";
+					}
+				}
+			}
+		}
+	}
+	std::cout << merged_count << " sharded renders merged, " << failures << " different from rendering in one go\n";
+	return failures ? 1 : 0;
+}